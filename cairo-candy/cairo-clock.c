@@ -34,14 +34,17 @@
 #include <gdk/gdkkeysyms.h>
 #include <gtk/gtk.h>
 #include <time.h>
+#include <sys/time.h>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 #include <librsvg/rsvg.h>
 #include <librsvg/rsvg-cairo.h>
 
+#include "frame-export.h"
+
 #define SECOND_INTERVAL  1000
-#define MINUTE_INTERVAL 60000
+#define TICK_SLACK          5	/* ms after the boundary, to be sure to be past it */
 #define MIN_WIDTH          32
 #define MIN_HEIGHT         32
 #define MAX_WIDTH         512
@@ -86,18 +89,97 @@ RsvgDimensionData	g_DimensionData;
 int					g_iSeconds;
 int					g_iMinutes;
 int					g_iHours;
-static time_t		g_timeOfDay;
 struct tm*			g_pTime;
 int					g_iEverySecond = 0;		/* 1/0 - draw/don't draw seconds */
 int					g_iDefaultWidth = 128;	/* window opens with this width */
 int					g_iDefaultHeight = 128;	/* ... and with this height */
 
-void render (int width, int height);
+/* the static layers below and above the hands, each rendered once into a
+** surface of the window's size, and every hand and hand-shadow rendered
+** once into a sprite of that size with the hand's pivot in the middle, so
+** a tick only has to composite these instead of rendering the SVGs again */
+cairo_surface_t*	g_pUnderlaySurface = NULL;
+cairo_surface_t*	g_pOverlaySurface = NULL;
+cairo_surface_t*	g_pHandSurfaces[CLOCK_ELEMENTS];
+int					g_iCacheWidth = 0;
+int					g_iCacheHeight = 0;
+
+/* the clock only wakes up when the displayed time changes and there is
+** someone to look at it */
+guint				g_iTimeoutId = 0;
+int					g_iMapped = 0;
+int					g_iObscured = 0;
+
+void render (int width, int height, time_t timeOfDay);
+
+/* milliseconds until the next full second, or minute if seconds are not
+** shown. It's measured from the wall-clock on every tick, so unlike a
+** periodic timeout it never drifts, while the timeout itself runs on GLib's
+** monotonic clock and is unaffected by the wall-clock being set */
+static guint next_interval (void)
+{
+	struct timeval tv;
+	guint iInterval;
+
+	gettimeofday (&tv, NULL);
+	iInterval = SECOND_INTERVAL - tv.tv_usec / 1000;
+	if (!g_iEverySecond)
+		iInterval += (59 - tv.tv_sec % 60) * SECOND_INTERVAL;
+
+	return iInterval + TICK_SLACK;
+}
+
+static gboolean time_handler (GtkWidget* pWidget);
+
+static void schedule_tick (GtkWidget* pWidget)
+{
+	if (g_iTimeoutId)
+		g_source_remove (g_iTimeoutId);
+	g_iTimeoutId = 0;
+
+	if (g_iMapped && !g_iObscured)
+		g_iTimeoutId = g_timeout_add (next_interval (),
+									  (GSourceFunc) time_handler,
+									  pWidget);
+}
 
+/* the redraw is only queued, so GDK folds it into the next expose along
+** with whatever else needs repainting */
 static gboolean time_handler (GtkWidget* pWidget)
 {
+	g_iTimeoutId = 0;
 	gtk_widget_queue_draw (pWidget);
-	return TRUE;
+	schedule_tick (pWidget);
+
+	return FALSE;
+}
+
+/* while the window is unmapped or fully covered nothing is drawn and no
+** timeout is pending, on becoming visible again it catches up at once */
+static gboolean on_map (GtkWidget* pWidget,
+						GdkEvent* pEvent,
+						gpointer userData)
+{
+	g_iMapped = pEvent->type == GDK_MAP;
+	if (g_iMapped && !g_iObscured)
+		gtk_widget_queue_draw (pWidget);
+	schedule_tick (pWidget);
+
+	return FALSE;
+}
+
+static gboolean on_visibility (GtkWidget* pWidget,
+							   GdkEventVisibility* pVisibility,
+							   gpointer userData)
+{
+	int iWasObscured = g_iObscured;
+
+	g_iObscured = pVisibility->state == GDK_VISIBILITY_FULLY_OBSCURED;
+	if (iWasObscured && !g_iObscured)
+		gtk_widget_queue_draw (pWidget);
+	schedule_tick (pWidget);
+
+	return FALSE;
 }
 
 static gboolean on_alpha_window_expose (GtkWidget*		pWidget,
@@ -109,7 +191,7 @@ static gboolean on_alpha_window_expose (GtkWidget*		pWidget,
 	g_pCairoContext = gdk_cairo_create (pWidget->window);
 	cairo_set_operator (g_pCairoContext, CAIRO_OPERATOR_SOURCE);
 	gtk_window_get_size (GTK_WINDOW (pWidget), &iWidth, &iHeight);
-	render (iWidth, iHeight);
+	render (iWidth, iHeight, time (NULL));
 	cairo_destroy (g_pCairoContext);
 
 	return FALSE;
@@ -169,87 +251,206 @@ gboolean on_button_press (GtkWidget* pWidget,
 	return TRUE;
 }
 
-void render (int width, int height)
+static cairo_surface_t* create_layer (int width, int height)
+{
+	return cairo_surface_create_similar (cairo_get_target (g_pCairoContext),
+										 CAIRO_CONTENT_COLOR_ALPHA,
+										 width,
+										 height);
+}
+
+static cairo_surface_t* render_layers (int width,
+									   int height,
+									   int iFirst,
+									   int iLast)
+{
+	cairo_surface_t* pSurface = create_layer (width, height);
+	cairo_t* pContext = cairo_create (pSurface);
+	int iElement;
+
+	cairo_scale (pContext,
+				 (double) width / (double) g_DimensionData.width,
+				 (double) height / (double) g_DimensionData.height);
+
+	for (iElement = iFirst; iElement <= iLast; iElement++)
+		rsvg_handle_render_cairo (g_pSvgHandles[iElement], pContext);
+
+	cairo_destroy (pContext);
+
+	return pSurface;
+}
+
+static cairo_surface_t* render_hand (int width, int height, int iElement)
+{
+	cairo_surface_t* pSurface = create_layer (width, height);
+	cairo_t* pContext = cairo_create (pSurface);
+
+	cairo_translate (pContext, width / 2.0f, height / 2.0f);
+	cairo_scale (pContext,
+				 (double) width / (double) g_DimensionData.width,
+				 (double) height / (double) g_DimensionData.height);
+	rsvg_handle_render_cairo (g_pSvgHandles[iElement], pContext);
+	cairo_destroy (pContext);
+
+	return pSurface;
+}
+
+static void free_cache (void)
+{
+	int iElement;
+
+	if (g_pUnderlaySurface)
+		cairo_surface_destroy (g_pUnderlaySurface);
+	if (g_pOverlaySurface)
+		cairo_surface_destroy (g_pOverlaySurface);
+	g_pUnderlaySurface = NULL;
+	g_pOverlaySurface = NULL;
+
+	for (iElement = 0; iElement < CLOCK_ELEMENTS; iElement++)
+	{
+		if (g_pHandSurfaces[iElement])
+			cairo_surface_destroy (g_pHandSurfaces[iElement]);
+		g_pHandSurfaces[iElement] = NULL;
+	}
+
+	g_iCacheWidth = 0;
+	g_iCacheHeight = 0;
+}
+
+/* (re)build the cached layers and sprites if the window changed its size */
+static void update_cache (int width, int height)
+{
+	int iElement;
+
+	if (width == g_iCacheWidth && height == g_iCacheHeight)
+		return;
+
+	free_cache ();
+
+	g_pUnderlaySurface = render_layers (width,
+										height,
+										CLOCK_DROP_SHADOW,
+										CLOCK_MARKS);
+	g_pOverlaySurface = render_layers (width,
+									   height,
+									   CLOCK_FACE_SHADOW,
+									   CLOCK_FRAME);
+
+	for (iElement = CLOCK_HOUR_HAND_SHADOW;
+		 iElement <= CLOCK_SECOND_HAND;
+		 iElement++)
+		g_pHandSurfaces[iElement] = render_hand (width, height, iElement);
+
+	g_iCacheWidth = width;
+	g_iCacheHeight = height;
+}
+
+/* draw a hand's sprite turned by fAngle around the middle of the clock,
+** the current transformation is the one the SVGs are rendered with, the
+** sprite is in device-space and has that scaling undone */
+static void draw_hand (int width,
+					   int height,
+					   int iElement,
+					   double fAngle,
+					   double fOffsetX,
+					   double fOffsetY)
+{
+	cairo_save (g_pCairoContext);
+	cairo_translate (g_pCairoContext, fOffsetX, fOffsetY);
+	cairo_rotate (g_pCairoContext, fAngle);
+	cairo_scale (g_pCairoContext,
+				 (double) g_DimensionData.width / (double) width,
+				 (double) g_DimensionData.height / (double) height);
+	cairo_set_source_surface (g_pCairoContext,
+							  g_pHandSurfaces[iElement],
+							  -width / 2.0f,
+							  -height / 2.0f);
+	cairo_paint (g_pCairoContext);
+	cairo_restore (g_pCairoContext);
+}
+
+void render (int width, int height, time_t timeOfDay)
 {
 	double fHalfX = g_DimensionData.width / 2.0f;
 	double fHalfY = g_DimensionData.height / 2.0f;
 	double fShadowOffsetX = -0.75f;
 	double fShadowOffsetY = 0.75f;
 
-	time (&g_timeOfDay);
-	g_pTime = localtime (&g_timeOfDay);
+	g_pTime = localtime (&timeOfDay);
 	g_iSeconds = g_pTime->tm_sec;
 	g_iMinutes = g_pTime->tm_min;
 	g_iHours   = g_pTime->tm_hour;
 	g_iHours = g_iHours >= 12 ? g_iHours - 12 : g_iHours;
 
-	cairo_save (g_pCairoContext);
-	cairo_scale (g_pCairoContext,
-				 (double) width / (double) g_DimensionData.width,
-				 (double) height / (double) g_DimensionData.height);
+	update_cache (width, height);
 
-	/* "clear" the background of the window to fully transparent */
-	cairo_set_source_rgba (g_pCairoContext, 1.0f, 1.0f, 1.0f, 0.0f);
+	/* the underlay replaces whatever was in the window, including the
+	** fully transparent background around the clock */
+	cairo_save (g_pCairoContext);
 	cairo_set_operator (g_pCairoContext, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface (g_pCairoContext, g_pUnderlaySurface, 0.0f, 0.0f);
 	cairo_paint (g_pCairoContext);
 
-	cairo_save (g_pCairoContext);
 	cairo_set_operator (g_pCairoContext, CAIRO_OPERATOR_OVER);
 
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_DROP_SHADOW], g_pCairoContext);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_FACE], g_pCairoContext);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_MARKS], g_pCairoContext);
-
 	cairo_save (g_pCairoContext);
+	cairo_scale (g_pCairoContext,
+				 (double) width / (double) g_DimensionData.width,
+				 (double) height / (double) g_DimensionData.height);
 	cairo_translate (g_pCairoContext, fHalfX, fHalfY);
 	cairo_rotate (g_pCairoContext, -M_PI/2.0f);
 
-	cairo_save (g_pCairoContext);
-	cairo_translate (g_pCairoContext, fShadowOffsetX, fShadowOffsetY);
-	cairo_rotate (g_pCairoContext, (M_PI/6.0f) * g_iHours);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_HOUR_HAND_SHADOW], g_pCairoContext);
-	cairo_restore (g_pCairoContext);
-
-	cairo_save (g_pCairoContext);
-	cairo_translate (g_pCairoContext, fShadowOffsetX, fShadowOffsetY);
-	cairo_rotate (g_pCairoContext, (M_PI/30.0f) * g_iMinutes);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_MINUTE_HAND_SHADOW], g_pCairoContext);
-	cairo_restore (g_pCairoContext);
-
+	draw_hand (width,
+			   height,
+			   CLOCK_HOUR_HAND_SHADOW,
+			   (M_PI/6.0f) * g_iHours,
+			   fShadowOffsetX,
+			   fShadowOffsetY);
+	draw_hand (width,
+			   height,
+			   CLOCK_MINUTE_HAND_SHADOW,
+			   (M_PI/30.0f) * g_iMinutes,
+			   fShadowOffsetX,
+			   fShadowOffsetY);
 	if (g_iEverySecond)
-	{
-		cairo_save (g_pCairoContext);
-		cairo_translate (g_pCairoContext, fShadowOffsetX, fShadowOffsetY);
-		cairo_rotate (g_pCairoContext, (M_PI/30.0f) * g_iSeconds);
-		rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_SECOND_HAND_SHADOW], g_pCairoContext);
-		cairo_restore (g_pCairoContext);
-	}
-
-	cairo_save (g_pCairoContext);
-	cairo_rotate (g_pCairoContext, (M_PI/6.0f) * g_iHours);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_HOUR_HAND], g_pCairoContext);
-	cairo_restore (g_pCairoContext);
+		draw_hand (width,
+				   height,
+				   CLOCK_SECOND_HAND_SHADOW,
+				   (M_PI/30.0f) * g_iSeconds,
+				   fShadowOffsetX,
+				   fShadowOffsetY);
+
+	draw_hand (width, height, CLOCK_HOUR_HAND, (M_PI/6.0f) * g_iHours, 0, 0);
+	draw_hand (width, height, CLOCK_MINUTE_HAND, (M_PI/30.0f) * g_iMinutes, 0, 0);
+	if (g_iEverySecond)
+		draw_hand (width,
+				   height,
+				   CLOCK_SECOND_HAND,
+				   (M_PI/30.0f) * g_iSeconds,
+				   0,
+				   0);
 
-	cairo_save (g_pCairoContext);
-	cairo_rotate (g_pCairoContext, (M_PI/30.0f) * g_iMinutes);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_MINUTE_HAND], g_pCairoContext);
 	cairo_restore (g_pCairoContext);
 
-	if (g_iEverySecond)
-	{
-		cairo_save (g_pCairoContext);
-		cairo_rotate (g_pCairoContext, (M_PI/30.0f) * g_iSeconds);
-		rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_SECOND_HAND], g_pCairoContext);
-		cairo_restore (g_pCairoContext);
-	}
+	cairo_set_source_surface (g_pCairoContext, g_pOverlaySurface, 0.0f, 0.0f);
+	cairo_paint (g_pCairoContext);
 
 	cairo_restore (g_pCairoContext);
+}
 
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_FACE_SHADOW], g_pCairoContext);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_GLASS], g_pCairoContext);
-	rsvg_handle_render_cairo (g_pSvgHandles[CLOCK_FRAME], g_pCairoContext);
+/* offline the clock runs on a virtual clock starting at g_exportStart and
+** advancing by g_iExportStep seconds per frame */
+time_t				g_exportStart;
+int					g_iExportStep = 0;
 
-	cairo_restore (g_pCairoContext);
+static void export_frame (cairo_t* pContext,
+						  int iFrame,
+						  int iWidth,
+						  int iHeight,
+						  void* pData)
+{
+	g_pCairoContext = pContext;
+	render (iWidth, iHeight, g_exportStart + (time_t) iFrame * g_iExportStep);
 }
 
 int main (int argc, char **argv)
@@ -257,6 +458,7 @@ int main (int argc, char **argv)
 	GtkWidget* pWindow = NULL;
 	GdkGeometry hints;
 	GError* pError;
+	FrameExport export;
 	int iElement;
 	int i;
 	int iTmp;
@@ -295,8 +497,25 @@ int main (int argc, char **argv)
 	/* this is just a quick&dirty command-line parsing, it should be replaced
 	** by something using libpopt... but right now I'm not motivated to look in
 	** the API-reference of libpopt */
+	frame_export_init (&export, g_iDefaultWidth, g_iDefaultHeight);
+	g_exportStart = time (NULL);
 	for (i = 1; i < argc ;i++)
 	{
+		if (frame_export_parse_option (&export, argc, argv, &i))
+			continue;
+
+		if (!strcmp (argv[i], "--start"))
+		{
+			g_exportStart = atol (argv[++i]);
+			continue;
+		}
+
+		if (!strcmp (argv[i], "--step"))
+		{
+			g_iExportStep = atoi (argv[++i]);
+			continue;
+		}
+
 		if (!strcmp (argv[i], "--seconds"))
 		{
 			g_iEverySecond = 1;
@@ -325,12 +544,16 @@ int main (int argc, char **argv)
 			printf ("\t--seconds (refresh every second and draw second-hand)\n");
 			printf ("\t--width <int> (open window with this width)\n");
 			printf ("\t--height <int> (open window with this height)\n");
+			frame_export_print_usage ();
+			printf ("\t--start <int> (export: time of the first frame in seconds\n");
+			printf ("\t               since the epoch, default: now)\n");
+			printf ("\t--step <int> (export: seconds per frame, default: 1 with\n");
+			printf ("\t              --seconds, 60 without)\n");
 			printf ("\t--help (this usage-description)\n");
 			exit (0);
 		}
 	}
 
-	gtk_init (&argc, &argv);
 	rsvg_init ();
 
 	for (iElement = 0; iElement < CLOCK_ELEMENTS; iElement++)
@@ -338,6 +561,27 @@ int main (int argc, char **argv)
 
 	rsvg_handle_get_dimensions (g_pSvgHandles[CLOCK_DROP_SHADOW], &g_DimensionData);
 
+	/* no display needed for that */
+	if (export.pcPath)
+	{
+		int iResult;
+
+		if (g_iExportStep <= 0)
+			g_iExportStep = g_iEverySecond ? 1 : 60;
+		export.iWidth = g_iDefaultWidth;
+		export.iHeight = g_iDefaultHeight;
+		iResult = frame_export (&export, export_frame, NULL);
+
+		free_cache ();
+		for (iElement = 0; iElement < CLOCK_ELEMENTS; iElement++)
+			rsvg_handle_free (g_pSvgHandles[iElement]);
+		rsvg_term ();
+
+		return iResult ? 1 : 0;
+	}
+
+	gtk_init (&argc, &argv);
+
 	pWindow = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	gtk_window_set_decorated (GTK_WINDOW (pWindow), FALSE);
 	gtk_window_set_resizable (GTK_WINDOW (pWindow), TRUE);
@@ -366,7 +610,10 @@ int main (int argc, char **argv)
 
 	/* that's needed here because a top-level GtkWindow does not listen to
 	 * "button-press-events" by default */
-	gtk_widget_add_events (pWindow, GDK_BUTTON_PRESS_MASK);
+	gtk_widget_add_events (pWindow,
+						   GDK_BUTTON_PRESS_MASK |
+						   GDK_STRUCTURE_MASK |
+						   GDK_VISIBILITY_NOTIFY_MASK);
 
 	g_signal_connect (G_OBJECT (pWindow),
 					  "expose-event",
@@ -383,18 +630,32 @@ int main (int argc, char **argv)
 					  G_CALLBACK (on_button_press),
 					  NULL);
 
+	g_signal_connect (G_OBJECT (pWindow),
+					  "map-event",
+					  G_CALLBACK (on_map),
+					  NULL);
+
+	g_signal_connect (G_OBJECT (pWindow),
+					  "unmap-event",
+					  G_CALLBACK (on_map),
+					  NULL);
+
+	g_signal_connect (G_OBJECT (pWindow),
+					  "visibility-notify-event",
+					  G_CALLBACK (on_visibility),
+					  NULL);
+
 	if (!GTK_WIDGET_VISIBLE (pWindow))
 		gtk_widget_show_all (pWindow);
 
-	if (g_iEverySecond)
-		gtk_timeout_add (SECOND_INTERVAL, (GtkFunction) time_handler, pWindow);
-	else
-		gtk_timeout_add (MINUTE_INTERVAL, (GtkFunction) time_handler, pWindow);
+	/* ticks are scheduled from on_map () once the window shows up */
 
 	g_pCairoContext = gdk_cairo_create (pWindow->window);
 
 	gtk_main ();
 
+	free_cache ();
+
 	for (iElement = 0; iElement < CLOCK_ELEMENTS; iElement++)
 		rsvg_handle_free (g_pSvgHandles[iElement]);
 
@@ -0,0 +1,471 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notes:
+**    The renderers of cairo-clock and wobbly-zini draw through globals, so
+**    rendering stays on the calling thread. Encoding (PNG-compression or the
+**    conversion to YUV) is what takes the time and runs on the threads. Each
+**    thread owns two image-surfaces, so rendering the next frame overlaps with
+**    encoding the last one. Y4M-frames are converted in parallel but written
+**    strictly in order.
+**
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "frame-export.h"
+
+#define MAX_THREADS		32
+#define SLOTS_PER_THREAD	2
+
+typedef struct
+{
+	cairo_surface_t*	pSurface;
+	int					iFrame;		/* frame held, -1 if the slot is free */
+} FrameSlot;
+
+typedef struct
+{
+	const FrameExport*	pExport;
+	FILE*				pStream;	/* Y4M only */
+	FrameSlot*			pSlots;
+	int					iSlots;
+
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	int					iNextToEncode;	/* frames are taken in order */
+	int					iNextToWrite;	/* Y4M-frames are written in order */
+	int					iRendered;
+	int					iError;
+} FrameQueue;
+
+typedef struct
+{
+	FrameQueue*			pQueue;
+	unsigned char*		pcYUV;		/* Y4M only */
+	pthread_t			thread;
+} FrameEncoder;
+
+static double get_seconds (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0f;
+}
+
+void frame_export_init (FrameExport* pExport, int iWidth, int iHeight)
+{
+	long lCPUs = sysconf (_SC_NPROCESSORS_ONLN);
+
+	pExport->pcPath = NULL;
+	pExport->format = FRAME_FORMAT_PNG;
+	pExport->iWidth = iWidth;
+	pExport->iHeight = iHeight;
+	pExport->iFrames = 100;
+	pExport->iThreads = lCPUs > 0 ? (int) lCPUs : 1;
+	pExport->iFramesPerSecond = 25;
+}
+
+int frame_export_parse_option (FrameExport* pExport,
+							   int argc,
+							   char** argv,
+							   int* piArg)
+{
+	const char* pcOption = argv[*piArg];
+	const char* pcValue;
+	int iValue;
+
+	if (strcmp (pcOption, "--export") &&
+		strcmp (pcOption, "--format") &&
+		strcmp (pcOption, "--frames") &&
+		strcmp (pcOption, "--threads") &&
+		strcmp (pcOption, "--fps"))
+		return 0;
+
+	if (*piArg + 1 >= argc)
+	{
+		fprintf (stderr, "%s needs a value\n", pcOption);
+		exit (1);
+	}
+	pcValue = argv[++*piArg];
+	iValue = atoi (pcValue);
+
+	if (!strcmp (pcOption, "--export"))
+		pExport->pcPath = pcValue;
+	else if (!strcmp (pcOption, "--format"))
+	{
+		if (!strcmp (pcValue, "png"))
+			pExport->format = FRAME_FORMAT_PNG;
+		else if (!strcmp (pcValue, "y4m"))
+			pExport->format = FRAME_FORMAT_Y4M;
+		else
+		{
+			fprintf (stderr, "unknown format \"%s\"\n", pcValue);
+			exit (1);
+		}
+	}
+	else if (!strcmp (pcOption, "--frames") && iValue > 0)
+		pExport->iFrames = iValue;
+	else if (!strcmp (pcOption, "--threads") && iValue > 0)
+		pExport->iThreads = iValue;
+	else if (!strcmp (pcOption, "--fps") && iValue > 0)
+		pExport->iFramesPerSecond = iValue;
+
+	return 1;
+}
+
+void frame_export_print_usage (void)
+{
+	printf ("\t--export <path> (render frames offline, without a window, to\n");
+	printf ("\t                 PNGs named by the printf-pattern <path> like\n");
+	printf ("\t                 frame-%%05d.png, or to the Y4M-file <path>)\n");
+	printf ("\t--format png|y4m (default: png, y4m with <path> \"-\" is stdout)\n");
+	printf ("\t--frames <int> (number of frames to export, default: 100)\n");
+	printf ("\t--fps <int> (frames per second of the export, default: 25)\n");
+	printf ("\t--threads <int> (encoder-threads, default: one per CPU)\n");
+}
+
+/* premultiplied ARGB to planar 4:2:0 YCbCr (full range, as C420jpeg), which
+** is the same as compositing the frame over black first */
+static void convert_to_yuv (cairo_surface_t* pSurface,
+							unsigned char* pcY,
+							unsigned char* pcU,
+							unsigned char* pcV)
+{
+	int iWidth = cairo_image_surface_get_width (pSurface);
+	int iHeight = cairo_image_surface_get_height (pSurface);
+	int iStride = cairo_image_surface_get_stride (pSurface);
+	unsigned char* pcData = cairo_image_surface_get_data (pSurface);
+	int iChromaWidth = (iWidth + 1) / 2;
+	int x;
+	int y;
+
+	cairo_surface_flush (pSurface);
+
+	for (y = 0; y < iHeight; y++)
+	{
+		unsigned int* puiRow = (unsigned int*) (pcData + y * iStride);
+
+		for (x = 0; x < iWidth; x++)
+		{
+			unsigned int uiPixel = puiRow[x];
+			int iR = (uiPixel >> 16) & 0xff;
+			int iG = (uiPixel >> 8) & 0xff;
+			int iB = uiPixel & 0xff;
+
+			pcY[y * iWidth + x] = (77 * iR + 150 * iG + 29 * iB + 128) >> 8;
+		}
+	}
+
+	for (y = 0; y < iHeight; y += 2)
+		for (x = 0; x < iWidth; x += 2)
+		{
+			int iR = 0;
+			int iG = 0;
+			int iB = 0;
+			int iCount = 0;
+			int dx;
+			int dy;
+
+			for (dy = 0; dy < 2 && y + dy < iHeight; dy++)
+				for (dx = 0; dx < 2 && x + dx < iWidth; dx++)
+				{
+					unsigned int* puiRow;
+					unsigned int uiPixel;
+
+					puiRow = (unsigned int*) (pcData + (y + dy) * iStride);
+					uiPixel = puiRow[x + dx];
+					iR += (uiPixel >> 16) & 0xff;
+					iG += (uiPixel >> 8) & 0xff;
+					iB += uiPixel & 0xff;
+					iCount++;
+				}
+
+			iR /= iCount;
+			iG /= iCount;
+			iB /= iCount;
+			pcU[(y / 2) * iChromaWidth + x / 2] =
+				(-43 * iR - 85 * iG + 128 * iB + 128 * 256 + 128) >> 8;
+			pcV[(y / 2) * iChromaWidth + x / 2] =
+				(128 * iR - 107 * iG - 21 * iB + 128 * 256 + 128) >> 8;
+		}
+}
+
+/* writes (PNG) or converts and writes in order (Y4M) the frame held by
+   pSlot, then hands the slot back to the renderer */
+static void encode_frame (FrameQueue* pQueue,
+						  FrameSlot* pSlot,
+						  int iFrame,
+						  unsigned char* pcYUV)
+{
+	const FrameExport* pExport = pQueue->pExport;
+	int iLumaSize = pExport->iWidth * pExport->iHeight;
+	int iChromaSize = ((pExport->iWidth + 1) / 2) * ((pExport->iHeight + 1) / 2);
+	char acFileName[1024];
+	int iError = 0;
+
+	if (!pSlot)
+		iError = 1;
+	else if (pExport->format == FRAME_FORMAT_PNG)
+	{
+		snprintf (acFileName, sizeof (acFileName), pExport->pcPath, iFrame);
+		if (cairo_surface_write_to_png (pSlot->pSurface, acFileName) !=
+			CAIRO_STATUS_SUCCESS)
+			iError = 1;
+	}
+	else
+	{
+		convert_to_yuv (pSlot->pSurface,
+						pcYUV,
+						pcYUV + iLumaSize,
+						pcYUV + iLumaSize + iChromaSize);
+	}
+
+	pthread_mutex_lock (&pQueue->mutex);
+	if (iError)
+		pQueue->iError = 1;
+	if (pExport->format == FRAME_FORMAT_Y4M)
+	{
+		/* the surface can be reused as soon as it is converted */
+		if (pSlot)
+			pSlot->iFrame = -1;
+		pthread_cond_broadcast (&pQueue->cond);
+
+		/* a frame that is missing still has to let the next ones through */
+		while (pQueue->iNextToWrite != iFrame)
+			pthread_cond_wait (&pQueue->cond, &pQueue->mutex);
+		if (pSlot)
+		{
+			fputs ("FRAME\n", pQueue->pStream);
+			if (fwrite (pcYUV, iLumaSize + 2 * iChromaSize, 1, pQueue->pStream) != 1)
+				pQueue->iError = 1;
+		}
+		pQueue->iNextToWrite++;
+	}
+	else if (pSlot)
+		pSlot->iFrame = -1;
+	pthread_cond_broadcast (&pQueue->cond);
+	pthread_mutex_unlock (&pQueue->mutex);
+}
+
+static void* encoder_main (void* pData)
+{
+	FrameEncoder* pEncoder = pData;
+	FrameQueue* pQueue = pEncoder->pQueue;
+	const FrameExport* pExport = pQueue->pExport;
+
+	for (;;)
+	{
+		FrameSlot* pSlot = NULL;
+		int iFrame;
+		int i;
+
+		/* wait for the next frame in order to be rendered */
+		pthread_mutex_lock (&pQueue->mutex);
+		while (pQueue->iNextToEncode < pExport->iFrames &&
+			   pQueue->iNextToEncode >= pQueue->iRendered)
+			pthread_cond_wait (&pQueue->cond, &pQueue->mutex);
+		if (pQueue->iNextToEncode >= pExport->iFrames)
+		{
+			pthread_mutex_unlock (&pQueue->mutex);
+			break;
+		}
+		iFrame = pQueue->iNextToEncode++;
+		for (i = 0; i < pQueue->iSlots; i++)
+			if (pQueue->pSlots[i].iFrame == iFrame)
+				pSlot = &pQueue->pSlots[i];
+		pthread_mutex_unlock (&pQueue->mutex);
+
+		encode_frame (pQueue, pSlot, iFrame, pEncoder->pcYUV);
+	}
+
+	return NULL;
+}
+
+int frame_export (const FrameExport* pExport,
+				  FrameRenderFunc render,
+				  void* pData)
+{
+	FrameQueue queue;
+	FrameEncoder aEncoders[MAX_THREADS];
+	FrameEncoder* pInline = NULL;
+	int iThreads = pExport->iThreads;
+	int iStarted;
+	int iYUVSize;
+	double fStart;
+	double fRenderTime = 0.0f;
+	double fTotalTime;
+	int iFrame;
+	int i;
+
+	if (iThreads < 1)
+		iThreads = 1;
+	if (iThreads > MAX_THREADS)
+		iThreads = MAX_THREADS;
+
+	memset (&queue, 0, sizeof (queue));
+	queue.pExport = pExport;
+	pthread_mutex_init (&queue.mutex, NULL);
+	pthread_cond_init (&queue.cond, NULL);
+
+	if (pExport->format == FRAME_FORMAT_Y4M)
+	{
+		if (!strcmp (pExport->pcPath, "-"))
+			queue.pStream = stdout;
+		else
+			queue.pStream = fopen (pExport->pcPath, "wb");
+		if (!queue.pStream)
+		{
+			perror (pExport->pcPath);
+			return -1;
+		}
+		fprintf (queue.pStream,
+				 "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+				 pExport->iWidth,
+				 pExport->iHeight,
+				 pExport->iFramesPerSecond);
+	}
+
+	queue.iSlots = iThreads * SLOTS_PER_THREAD;
+	queue.pSlots = malloc (queue.iSlots * sizeof (FrameSlot));
+	if (!queue.pSlots)
+	{
+		fprintf (stderr, "out of memory\n");
+		if (queue.pStream && queue.pStream != stdout)
+			fclose (queue.pStream);
+		pthread_cond_destroy (&queue.cond);
+		pthread_mutex_destroy (&queue.mutex);
+		return -1;
+	}
+	for (i = 0; i < queue.iSlots; i++)
+	{
+		queue.pSlots[i].pSurface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+															   pExport->iWidth,
+															   pExport->iHeight);
+		queue.pSlots[i].iFrame = -1;
+	}
+
+	/* as many encoders as can be started, if none can the frames are
+	   encoded right after rendering them */
+	iYUVSize = pExport->iWidth * pExport->iHeight +
+			   2 * ((pExport->iWidth + 1) / 2) * ((pExport->iHeight + 1) / 2);
+	for (iStarted = 0; iStarted < iThreads; iStarted++)
+	{
+		FrameEncoder* pEncoder = &aEncoders[iStarted];
+
+		pEncoder->pQueue = &queue;
+		pEncoder->pcYUV = NULL;
+		if (pExport->format == FRAME_FORMAT_Y4M &&
+			!(pEncoder->pcYUV = malloc (iYUVSize)))
+			break;
+		if (pthread_create (&pEncoder->thread, NULL, encoder_main, pEncoder))
+		{
+			free (pEncoder->pcYUV);
+			break;
+		}
+	}
+
+	if (iStarted == 0)
+	{
+		pInline = &aEncoders[0];
+		pInline->pQueue = &queue;
+		pInline->pcYUV = NULL;
+		if (pExport->format == FRAME_FORMAT_Y4M &&
+			!(pInline->pcYUV = malloc (iYUVSize)))
+			pInline = NULL;
+	}
+
+	if (iStarted == 0 && !pInline)
+	{
+		fprintf (stderr, "out of memory\n");
+		queue.iError = 1;
+	}
+	else if (iStarted < iThreads)
+		fprintf (stderr,
+				 "could only start %d of %d encoder-threads%s\n",
+				 iStarted,
+				 iThreads,
+				 iStarted ? "" : ", encoding inline");
+
+	fStart = get_seconds ();
+	for (iFrame = 0; iFrame < pExport->iFrames && (iStarted || pInline); iFrame++)
+	{
+		FrameSlot* pSlot = NULL;
+		cairo_t* pContext;
+		double fRenderStart;
+
+		/* wait for a surface the encoders are done with */
+		pthread_mutex_lock (&queue.mutex);
+		for (;;)
+		{
+			for (i = 0; i < queue.iSlots && !pSlot; i++)
+				if (queue.pSlots[i].iFrame < 0)
+					pSlot = &queue.pSlots[i];
+			if (pSlot)
+				break;
+			pthread_cond_wait (&queue.cond, &queue.mutex);
+		}
+		pthread_mutex_unlock (&queue.mutex);
+
+		fRenderStart = get_seconds ();
+		pContext = cairo_create (pSlot->pSurface);
+		cairo_set_operator (pContext, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_rgba (pContext, 0.0f, 0.0f, 0.0f, 0.0f);
+		cairo_paint (pContext);
+		render (pContext, iFrame, pExport->iWidth, pExport->iHeight, pData);
+		cairo_destroy (pContext);
+		fRenderTime += get_seconds () - fRenderStart;
+
+		pthread_mutex_lock (&queue.mutex);
+		pSlot->iFrame = iFrame;
+		queue.iRendered = iFrame + 1;
+		if (pInline)
+			queue.iNextToEncode = iFrame + 1;
+		pthread_cond_broadcast (&queue.cond);
+		pthread_mutex_unlock (&queue.mutex);
+
+		if (pInline)
+			encode_frame (&queue, pSlot, iFrame, pInline->pcYUV);
+	}
+
+	for (i = 0; i < iStarted; i++)
+	{
+		pthread_join (aEncoders[i].thread, NULL);
+		free (aEncoders[i].pcYUV);
+	}
+	if (pInline)
+		free (pInline->pcYUV);
+	fTotalTime = get_seconds () - fStart;
+
+	for (i = 0; i < queue.iSlots; i++)
+		cairo_surface_destroy (queue.pSlots[i].pSurface);
+	free (queue.pSlots);
+
+	if (queue.pStream && queue.pStream != stdout)
+		fclose (queue.pStream);
+	else if (queue.pStream)
+		fflush (queue.pStream);
+
+	pthread_cond_destroy (&queue.cond);
+	pthread_mutex_destroy (&queue.mutex);
+
+	fprintf (stderr,
+			 "%d frames of %dx%d in %.2f s: %.1f frames/sec "
+			 "(rendering alone %.1f frames/sec, %d encoder-threads)\n",
+			 pExport->iFrames,
+			 pExport->iWidth,
+			 pExport->iHeight,
+			 fTotalTime,
+			 pExport->iFrames / (fTotalTime > 0.0f ? fTotalTime : 1.0f),
+			 pExport->iFrames / (fRenderTime > 0.0f ? fRenderTime : 1.0f),
+			 iStarted);
+
+	return queue.iError ? -1 : 0;
+}
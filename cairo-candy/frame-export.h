@@ -0,0 +1,60 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notes:
+**    Offline rendering shared by cairo-clock and wobbly-zini. Frames are
+**    rendered one after another into image-surfaces and handed to a pool of
+**    encoder-threads, which write them as a numbered PNG-sequence or as one
+**    raw YUV4MPEG2-stream.
+**
+*******************************************************************************/
+
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <cairo.h>
+
+typedef enum
+{
+	FRAME_FORMAT_PNG = 0,
+	FRAME_FORMAT_Y4M
+} FrameFormat;
+
+/* render frame iFrame into pContext, which is cleared to transparent */
+typedef void (*FrameRenderFunc) (cairo_t* pContext,
+								 int iFrame,
+								 int iWidth,
+								 int iHeight,
+								 void* pData);
+
+typedef struct
+{
+	const char*	pcPath;		/* printf-pattern for PNGs, file or "-" for Y4M */
+	FrameFormat	format;
+	int			iWidth;
+	int			iHeight;
+	int			iFrames;
+	int			iThreads;
+	int			iFramesPerSecond;	/* of the virtual clock and the Y4M-header */
+} FrameExport;
+
+/* fill in the defaults: PNG, 25 frames/sec, one thread per CPU */
+void frame_export_init (FrameExport* pExport, int iWidth, int iHeight);
+
+/* consume one of --export <path>, --format png|y4m, --frames <int>,
+** --threads <int> or --fps <int> at argv[*piArg], advancing *piArg past its
+** value; returns 0 if argv[*piArg] is none of them */
+int frame_export_parse_option (FrameExport* pExport,
+							   int argc,
+							   char** argv,
+							   int* piArg);
+
+void frame_export_print_usage (void);
+
+/* returns 0 on success, prints the achieved frame-rates to stderr */
+int frame_export (const FrameExport* pExport,
+				  FrameRenderFunc render,
+				  void* pData);
+
+#endif /* FRAME_EXPORT_H */
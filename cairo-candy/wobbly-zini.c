@@ -33,15 +33,21 @@
 #include <math.h>
 #include <sys/time.h>
 #include <strings.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "frame-export.h"
 
 #define WIN_WIDTH 400
 #define WIN_HEIGHT 400
 #define MS_INTERVAL 10
+#define SEGMENTS 60
+#define BUCKETS 6	/* segments of similar alpha are stroked together */
 
 cairo_t*			g_pCairoContext;
 struct timeval	g_timeValue;
 
-void wobbly_zini_render (int width, int height);
+void wobbly_zini_render (int width, int height, unsigned long ulMilliSeconds);
 
 static gboolean time_handler (GtkWidget* pWidget)
 {
@@ -58,7 +64,8 @@ static gboolean on_alpha_window_expose (GtkWidget*		pWidget,
 	g_pCairoContext = gdk_cairo_create (pWidget->window);
 	cairo_set_operator (g_pCairoContext, CAIRO_OPERATOR_SOURCE);
 	gtk_window_get_size (GTK_WINDOW (pWidget), &iWidth, &iHeight);
-	wobbly_zini_render (iWidth, iHeight);
+	gettimeofday (&g_timeValue, NULL);
+	wobbly_zini_render (iWidth, iHeight, g_timeValue.tv_usec / 1000);
 	cairo_destroy (g_pCairoContext);
 
 	return FALSE;
@@ -123,46 +130,145 @@ gboolean on_button_press (GtkWidget* pWidget,
 	return TRUE;
 }
 
-void wobbly_zini_render (int width, int height)
+/* the animation repeats every second, ulMilliSeconds is the time into it */
+void wobbly_zini_render (int width, int height, unsigned long ulMilliSeconds)
 {
 	double fLength = 1.0f / 25.0f;
-	double fY;
+	double afAngle[SEGMENTS];
+	double afY[SEGMENTS];
+	double afX1[SEGMENTS];
+	double afY1[SEGMENTS];
+	double afX2[SEGMENTS];
+	double afY2[SEGMENTS];
 	int i;
-	unsigned long ulMilliSeconds;
+	int iBucket;
 
 	cairo_save (g_pCairoContext);
 	cairo_scale (g_pCairoContext, (double) width / 1.0f, (double) height / 1.0f);
 
-    gettimeofday (&g_timeValue, NULL);
-    ulMilliSeconds = g_timeValue.tv_usec / 1000.0f;
-
 	/* "clear" the background of the window to fully transparent */
 	cairo_set_source_rgba (g_pCairoContext, 0.0f, 0.0f, 0.0f, 0.0f);
 	cairo_paint (g_pCairoContext);
 
+	/* each segment is centered at fY from the middle, turned by its angle,
+	** and turned by another 6 degrees per segment around its own center;
+	** the endpoints are worked out here in plain loops over all segments
+	** rather than through cairo's transformation-stack one at a time */
+	for (i = 0; i < SEGMENTS; i++)
+	{
+		afAngle[i] = M_PI/180.0f * (ulMilliSeconds + 10.0f*i) * 0.36f;
+		afY[i] = 0.33f + 0.0825f * sin ((ulMilliSeconds + 10.0f*i)/1000 * 10 * M_PI);
+	}
+
+	for (i = 0; i < SEGMENTS; i++)
+	{
+		double fCenterX = 0.5f - afY[i] * sin (afAngle[i]);
+		double fCenterY = 0.5f + afY[i] * cos (afAngle[i]);
+		double fDirection = afAngle[i] + M_PI/180.0f * 6.0f * i;
+		double fDX = fLength * cos (fDirection);
+		double fDY = fLength * sin (fDirection);
+
+		afX1[i] = fCenterX - fDX;
+		afY1[i] = fCenterY - fDY;
+		afX2[i] = fCenterX + fDX;
+		afY2[i] = fCenterY + fDY;
+	}
+
+	/* the alpha rises by 0.01 per segment, so neighbours are grouped into a
+	** few buckets and each bucket is stroked as one path with its mean alpha */
 	cairo_set_operator (g_pCairoContext, CAIRO_OPERATOR_OVER);
 	cairo_set_line_cap (g_pCairoContext, CAIRO_LINE_CAP_ROUND);
-	for (i = 0; i < 60; i++)
+	cairo_set_line_width (g_pCairoContext, fLength);
+	for (iBucket = 0; iBucket < BUCKETS; iBucket++)
 	{
-		cairo_save (g_pCairoContext);
-		cairo_set_line_width (g_pCairoContext, fLength);
-		cairo_translate (g_pCairoContext, 0.5f, 0.5f);
-		cairo_rotate (g_pCairoContext, M_PI/180.0f * (ulMilliSeconds + 10.0f*i) * 0.36f);
-		fY = 0.33f + 0.0825f * sin ((ulMilliSeconds + 10.0f*i)/1000 * 10 * M_PI);
-		cairo_translate (g_pCairoContext, 0, fY);
-		cairo_rotate (g_pCairoContext, M_PI/180.0f * 6.0f * i);
-		cairo_set_source_rgba (g_pCairoContext, 1.0f, 0.5f, 0.0f, i*0.01f);
-		cairo_move_to (g_pCairoContext, -fLength, 0);
-		cairo_line_to (g_pCairoContext, fLength, 0);
+		int iFirst = iBucket * SEGMENTS / BUCKETS;
+		int iLast = (iBucket + 1) * SEGMENTS / BUCKETS - 1;
+
+		for (i = iFirst; i <= iLast; i++)
+		{
+			cairo_move_to (g_pCairoContext, afX1[i], afY1[i]);
+			cairo_line_to (g_pCairoContext, afX2[i], afY2[i]);
+		}
+
+		cairo_set_source_rgba (g_pCairoContext,
+							   1.0f,
+							   0.5f,
+							   0.0f,
+							   (iFirst + iLast) * 0.5f * 0.01f);
 		cairo_stroke (g_pCairoContext);
-		cairo_restore (g_pCairoContext);
 	}
+
+	cairo_restore (g_pCairoContext);
+}
+
+/* offline the animation runs on a virtual clock advancing by exactly one
+** frame's duration per frame, however long rendering it takes */
+static void export_frame (cairo_t* pContext,
+						  int iFrame,
+						  int iWidth,
+						  int iHeight,
+						  void* pData)
+{
+	FrameExport* pExport = pData;
+
+	g_pCairoContext = pContext;
+	wobbly_zini_render (iWidth,
+						iHeight,
+						((unsigned long) iFrame * 1000 /
+						 pExport->iFramesPerSecond) % 1000);
 }
 
 int main (int argc, char **argv)
 {
 	GtkWidget* pWindow = NULL;
 	GdkGeometry hints;
+	FrameExport export;
+	int iWidth = WIN_WIDTH;
+	int iHeight = WIN_HEIGHT;
+	int i;
+
+	frame_export_init (&export, WIN_WIDTH, WIN_HEIGHT);
+	for (i = 1; i < argc; i++)
+	{
+		if (frame_export_parse_option (&export, argc, argv, &i))
+			continue;
+
+		if (!strcmp (argv[i], "--width") && i + 1 < argc)
+		{
+			iWidth = atoi (argv[++i]);
+			continue;
+		}
+
+		if (!strcmp (argv[i], "--height") && i + 1 < argc)
+		{
+			iHeight = atoi (argv[++i]);
+			continue;
+		}
+
+		if (!strcmp (argv[i], "--help"))
+		{
+			printf ("Usage: %s\n", argv[0]);
+			printf ("\t--width <int> (window- or frame-width)\n");
+			printf ("\t--height <int> (window- or frame-height)\n");
+			frame_export_print_usage ();
+			printf ("\t--help (this usage-description)\n");
+			exit (0);
+		}
+	}
+
+	if (iWidth < 1 || iHeight < 1)
+	{
+		iWidth = WIN_WIDTH;
+		iHeight = WIN_HEIGHT;
+	}
+
+	/* no display needed for that */
+	if (export.pcPath)
+	{
+		export.iWidth = iWidth;
+		export.iHeight = iHeight;
+		return frame_export (&export, export_frame, &export) ? 1 : 0;
+	}
 
 	gtk_init (&argc, &argv);
 
@@ -173,7 +279,7 @@ int main (int argc, char **argv)
 	gtk_widget_set_app_paintable (pWindow, TRUE);
 	gtk_window_set_icon_from_file (GTK_WINDOW (pWindow), "./wobbly-zini-icon.png", NULL);	
 	gtk_window_set_title (GTK_WINDOW (pWindow), "MacSlow's Wobbly-Zini");
-	gtk_window_set_default_size (GTK_WINDOW (pWindow), WIN_WIDTH, WIN_HEIGHT);
+	gtk_window_set_default_size (GTK_WINDOW (pWindow), iWidth, iHeight);
 
 	hints.min_width = 64;
 	hints.min_height = 64;
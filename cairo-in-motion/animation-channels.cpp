@@ -0,0 +1,203 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "animation-channels.h"
+
+FastRandom::FastRandom (unsigned int uiSeed)
+{
+	// xorshift gets stuck on zero
+	m_uiState = uiSeed ? uiSeed : 0x9e3779b9;
+}
+
+unsigned int FastRandom::next ()
+{
+	m_uiState ^= m_uiState << 13;
+	m_uiState ^= m_uiState >> 17;
+	m_uiState ^= m_uiState << 5;
+
+	return m_uiState;
+}
+
+double FastRandom::next_double ()
+{
+	return (next () >> 8) / 16777216.0f;
+}
+
+// start-value, limits and the range of speeds after a bounce, all in units
+// per second. These are the old per-tick steps at the default 25ms per tick
+typedef struct _ChannelSetup
+{
+	float fStart;
+	float fStartSpeed;
+	float fLower;
+	float fUpper;
+	float fGrowMin;
+	float fGrowMax;
+	float fShrinkMin;
+	float fShrinkMax;
+} ChannelSetup;
+
+static const ChannelSetup channelSetup[AnimationChannels::NumberOfChannels] =
+{
+	{ 0.5f,    0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// CenterX
+	{ 0.5f,    0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// CenterY
+	{ 0.1f,   -0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point1X
+	{ 0.2f,   -0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point1Y
+	{ 0.5f,    0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point2X
+	{ 0.5f,   -0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point2Y
+	{ 0.8f,    0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point3X
+	{ 0.4f,   -0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point3Y
+	{ 0.2f,    0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point4X
+	{ 0.9f,   -0.1f,  0.0f,   1.0f,  0.25f, 1.0f, -1.0f, -0.25f },	// Point4Y
+	{ 0.25f,   0.1f,  0.05f,  0.5f,  0.125f, 0.5f, -0.5f, -0.125f },	// Radius
+	{ 0.0f,   20.0f,  0.0f, 360.0f, 20.0f, 20.0f, -40.0f, -40.0f },	// Angle1
+	{ 360.0f, -60.0f, 0.0f, 360.0f, 80.0f, 80.0f, -30.0f, -30.0f }	// Angle2
+};
+
+AnimationChannels::AnimationChannels (int iInstances, unsigned int uiSeed) :
+	m_random (uiSeed)
+{
+	int iElements;
+	int i;
+
+	m_iInstances = iInstances > 0 ? iInstances : 1;
+	m_ulGeneration = 0;
+	iElements = m_iInstances * NumberOfChannels;
+
+	m_afValue.resize (iElements);
+	m_afSpeed.resize (iElements);
+	m_afLower.resize (iElements);
+	m_afUpper.resize (iElements);
+	m_afGrowMin.resize (iElements);
+	m_afGrowMax.resize (iElements);
+	m_afShrinkMin.resize (iElements);
+	m_afShrinkMax.resize (iElements);
+	m_afGrow.resize (iElements);
+	m_afShrink.resize (iElements);
+	m_aiBounced.resize (iElements);
+
+	for (i = 0; i < iElements; i++)
+	{
+		const ChannelSetup* pSetup = &channelSetup[i % NumberOfChannels];
+
+		m_afLower[i] = pSetup->fLower;
+		m_afUpper[i] = pSetup->fUpper;
+		m_afGrowMin[i] = pSetup->fGrowMin;
+		m_afGrowMax[i] = pSetup->fGrowMax;
+		m_afShrinkMin[i] = pSetup->fShrinkMin;
+		m_afShrinkMax[i] = pSetup->fShrinkMax;
+		m_aiBounced[i] = 0;
+		pick_speeds (i);
+
+		// the first instance starts like the samples always did, the
+		// others somewhere in between, so they don't move in lock-step
+		if (i < NumberOfChannels)
+		{
+			m_afValue[i] = pSetup->fStart;
+			m_afSpeed[i] = pSetup->fStartSpeed;
+		}
+		else
+		{
+			m_afValue[i] = pSetup->fLower + (pSetup->fUpper - pSetup->fLower) *
+						   m_random.next_double ();
+			m_afSpeed[i] = m_random.next () & 1 ? m_afGrow[i] : m_afShrink[i];
+		}
+	}
+}
+
+void AnimationChannels::pick_speeds (int iElement)
+{
+	m_afGrow[iElement] = m_afGrowMin[iElement] +
+						 (m_afGrowMax[iElement] - m_afGrowMin[iElement]) *
+						 m_random.next_double ();
+	m_afShrink[iElement] = m_afShrinkMin[iElement] +
+						   (m_afShrinkMax[iElement] - m_afShrinkMin[iElement]) *
+						   m_random.next_double ();
+}
+
+// no branches, no calls and no aliasing (there are too many arrays for gcc to
+// check for overlap at run-time), so this loop vectorizes
+static void advance_elements (float* __restrict pfValue,
+							  float* __restrict pfSpeed,
+							  int* __restrict piBounced,
+							  const float* __restrict pfLower,
+							  const float* __restrict pfUpper,
+							  const float* __restrict pfGrow,
+							  const float* __restrict pfShrink,
+							  int iElements,
+							  float fDelta)
+{
+	for (int i = 0; i < iElements; i++)
+	{
+		float fSpeed = pfSpeed[i];
+		float fValue = pfValue[i] + fSpeed * fDelta;
+		float fLower = pfLower[i];
+		float fUpper = pfUpper[i];
+		float fGrow = pfGrow[i];
+		float fShrink = pfShrink[i];
+		int iBelow = fValue <= fLower;
+		int iAbove = fValue >= fUpper;
+
+		fValue = iBelow ? fLower : fValue;
+		fValue = iAbove ? fUpper : fValue;
+		fSpeed = iBelow ? fGrow : fSpeed;
+		fSpeed = iAbove ? fShrink : fSpeed;
+		pfValue[i] = fValue;
+		pfSpeed[i] = fSpeed;
+		piBounced[i] = iBelow | iAbove;
+	}
+}
+
+// only the few channels that bounced go through the random-number generator
+void AnimationChannels::advance (double fSeconds)
+{
+	int iElements = m_afValue.size ();
+	int i;
+
+	advance_elements (&m_afValue[0],
+					  &m_afSpeed[0],
+					  &m_aiBounced[0],
+					  &m_afLower[0],
+					  &m_afUpper[0],
+					  &m_afGrow[0],
+					  &m_afShrink[0],
+					  iElements,
+					  (float) fSeconds);
+
+	for (i = 0; i < iElements; i++)
+		if (m_aiBounced[i])
+			pick_speeds (i);
+
+	m_ulGeneration++;
+}
+
+double AnimationChannels::get (int iInstance, Channel channel) const
+{
+	return m_afValue[iInstance * NumberOfChannels + channel];
+}
+
+int AnimationChannels::get_instances () const
+{
+	return m_iInstances;
+}
+
+unsigned long AnimationChannels::get_generation () const
+{
+	return m_ulGeneration;
+}
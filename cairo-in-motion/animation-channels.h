@@ -0,0 +1,96 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _ANIMATIONCHANNELS_H_
+#define _ANIMATIONCHANNELS_H_
+
+#include <vector>
+
+// xorshift32, small and fast, and unlike rand () every user has its own state
+class FastRandom
+{
+	public:
+		FastRandom (unsigned int uiSeed = 42);
+		unsigned int next ();
+		double next_double ();	// in [0.0, 1.0)
+
+	private:
+		unsigned int m_uiState;
+};
+
+// the values the samples are animated with (center, four points, radius and
+// two angles), each bouncing between two limits at a speed that's picked at
+// random again on every bounce. Any number of independent instances is kept
+// in flat arrays, one element per channel and instance, so advancing all of
+// them is one loop the compiler can vectorize
+class AnimationChannels
+{
+	public:
+		enum Channel
+		{
+			CenterX = 0,
+			CenterY,
+			Point1X,
+			Point1Y,
+			Point2X,
+			Point2Y,
+			Point3X,
+			Point3Y,
+			Point4X,
+			Point4Y,
+			Radius,
+			Angle1,
+			Angle2,
+			NumberOfChannels
+		};
+
+		AnimationChannels (int iInstances = 1, unsigned int uiSeed = 42);
+
+		// moves every channel of every instance on by fSeconds
+		void advance (double fSeconds);
+		double get (int iInstance, Channel channel) const;
+		int get_instances () const;
+
+		// counts advance (), so whoever draws with the channels can tell
+		// whether they moved since the last time
+		unsigned long get_generation () const;
+
+	private:
+		void pick_speeds (int iElement);
+
+		int					m_iInstances;
+		unsigned long		m_ulGeneration;
+		FastRandom			m_random;
+
+		// element iInstance * NumberOfChannels + channel, speeds in units
+		// per second
+		std::vector<float>	m_afValue;
+		std::vector<float>	m_afSpeed;
+		std::vector<float>	m_afLower;
+		std::vector<float>	m_afUpper;
+		std::vector<float>	m_afGrowMin;
+		std::vector<float>	m_afGrowMax;
+		std::vector<float>	m_afShrinkMin;
+		std::vector<float>	m_afShrinkMax;
+		std::vector<float>	m_afGrow;	// speed after hitting the lower limit
+		std::vector<float>	m_afShrink;	// ... and the upper one
+		std::vector<int>	m_aiBounced;
+};
+
+#endif /*_ANIMATIONCHANNELS_H_*/
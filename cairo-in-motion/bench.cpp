@@ -0,0 +1,339 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cairo-in-motion-bench runs every sample of CairoSamples headless against an
+// image-surface for a number of animation-steps and reports how long a frame
+// took, so it doubles as a micro-benchmark of cairo's operators, clipping,
+// gradients, text, dashes and so on
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "cairo-samples.h"
+#include "tiled-renderer.h"
+
+typedef struct _BenchSize
+{
+	int iWidth;
+	int iHeight;
+} BenchSize;
+
+typedef struct _BenchResult
+{
+	BenchSize size;
+	std::string strSample;
+	int iSteps;
+	double fMeanMs;
+	double fP99Ms;
+	double fOpsPerSec;
+	int iThreads;		// tiled rendering, only done with more than one
+	double fTiledMeanMs;
+	double fSpeedup;
+} BenchResult;
+
+static double get_milliseconds ()
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec * 1000.0f + tv.tv_usec / 1000.0f;
+}
+
+// same defaults as the ones main.cpp starts the UI with
+static void setup_samples (CairoSamples* pCairoSamples)
+{
+	pCairoSamples->set_cap_style (CAIRO_LINE_CAP_ROUND);
+	pCairoSamples->set_join_style (CAIRO_LINE_JOIN_ROUND);
+	pCairoSamples->set_dash_style (CairoSamples::DashOff);
+	pCairoSamples->set_operator (CAIRO_OPERATOR_CLEAR);
+	pCairoSamples->set_extend_mode (CAIRO_EXTEND_REPEAT);
+	pCairoSamples->set_filter_mode (CAIRO_FILTER_GOOD);
+	pCairoSamples->set_line_width (0.01f);
+	pCairoSamples->set_bg_color (Gdk::Color ("#B0B0B0"));
+	pCairoSamples->set_font_family ("Sans");
+	pCairoSamples->set_font_size (0.35f);
+	pCairoSamples->set_font_weight (CAIRO_FONT_WEIGHT_NORMAL);
+	pCairoSamples->set_font_slant (CAIRO_FONT_SLANT_NORMAL);
+	pCairoSamples->set_some_text ("laber");
+	pCairoSamples->set_image_file_name ("./gotroot.png");
+	pCairoSamples->set_svg_file_name ("./freedesktop.svg");
+}
+
+static BenchResult run_sample (CairoSamples::Sample sample,
+							   BenchSize size,
+							   int iSteps,
+							   int iStepMs,
+							   TiledRenderer* pTiledRenderer,
+							   bool bReplayCache)
+{
+	CairoSamples* pCairoSamples = new CairoSamples ();
+	cairo_surface_t* pSurface;
+	Cairo::Context* pCairoContext;
+	cairo_t* pContext;
+	std::vector<double> times;
+	double fTotal = 0.0f;
+	BenchResult result;
+	int iStep;
+
+	pSurface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+										   size.iWidth,
+										   size.iHeight);
+	pCairoContext = new Cairo::Context (cairo_create (pSurface), true);
+	pContext = pCairoContext->cobj ();
+	setup_samples (pCairoSamples);
+	pCairoSamples->set_replay_cache (bReplayCache);
+	pCairoSamples->set_context (pCairoContext);
+	CairoSamples start (*pCairoSamples);
+
+	// every sample starts from the same animation-state, and the
+	// animation-step itself is not part of the measured time
+	for (iStep = 0; iStep < iSteps; iStep++)
+	{
+		double fStart;
+		double fTime;
+
+		pCairoSamples->do_animation_step ((unsigned long) iStep * iStepMs);
+
+		fStart = get_milliseconds ();
+		cairo_save (pContext);
+		cairo_set_source_rgb (pContext, 1.0f, 1.0f, 1.0f);
+		cairo_paint (pContext);
+		pCairoSamples->normalize_canvas ((double) size.iWidth,
+										 (double) size.iHeight);
+		pCairoSamples->do_sample (sample);
+		cairo_restore (pContext);
+		cairo_new_path (pContext);
+		cairo_surface_flush (pSurface);
+		fTime = get_milliseconds () - fStart;
+
+		times.push_back (fTime);
+		fTotal += fTime;
+	}
+
+	std::sort (times.begin (), times.end ());
+	result.size = size;
+	result.strSample = pCairoSamples->get_sample_name (sample);
+	result.iSteps = iSteps;
+	result.fMeanMs = fTotal / iSteps;
+	result.fP99Ms = times[(times.size () * 99 - 1) / 100];
+	result.fOpsPerSec = fTotal > 0.0f ? iSteps * 1000.0f / fTotal : 0.0f;
+	result.iThreads = 1;
+	result.fTiledMeanMs = result.fMeanMs;
+	result.fSpeedup = 1.0f;
+
+	// the same steps once more, split over the threads
+	if (pTiledRenderer && pTiledRenderer->get_threads () > 1)
+	{
+		double fTiledTotal = 0.0f;
+
+		*pCairoSamples = start;
+
+		for (iStep = 0; iStep < iSteps; iStep++)
+		{
+			double fStart;
+
+			pCairoSamples->do_animation_step ((unsigned long) iStep * iStepMs);
+
+			fStart = get_milliseconds ();
+			pTiledRenderer->render (*pCairoSamples,
+									sample,
+									pSurface,
+									1.0f,
+									1.0f,
+									1.0f);
+			fTiledTotal += get_milliseconds () - fStart;
+		}
+
+		result.iThreads = pTiledRenderer->get_threads ();
+		result.fTiledMeanMs = fTiledTotal / iSteps;
+		result.fSpeedup = fTiledTotal > 0.0f ? fTotal / fTiledTotal : 0.0f;
+	}
+
+	delete pCairoContext;
+	cairo_surface_destroy (pSurface);
+	delete pCairoSamples;
+
+	return result;
+}
+
+// parses a comma-separated list like "256x256,1024x768"
+static bool parse_sizes (const char* pcSizes, std::vector<BenchSize>* pSizes)
+{
+	std::stringstream list (pcSizes);
+	std::string strSize;
+
+	pSizes->clear ();
+	while (std::getline (list, strSize, ','))
+	{
+		BenchSize size;
+
+		if (sscanf (strSize.c_str (), "%dx%d", &size.iWidth, &size.iHeight) != 2 ||
+			size.iWidth < 1 || size.iHeight < 1)
+			return false;
+
+		pSizes->push_back (size);
+	}
+
+	return !pSizes->empty ();
+}
+
+static void print_csv (const std::vector<BenchResult>& results)
+{
+	std::cout << "width,height,sample,steps,mean_ms,p99_ms,ops_per_sec,"
+			  << "threads,tiled_mean_ms,speedup" << std::endl;
+
+	for (std::vector<BenchResult>::const_iterator iter = results.begin ();
+		 iter != results.end ();
+		 iter++)
+	{
+		std::cout << iter->size.iWidth << ","
+				  << iter->size.iHeight << ","
+				  << iter->strSample << ","
+				  << iter->iSteps << ","
+				  << iter->fMeanMs << ","
+				  << iter->fP99Ms << ","
+				  << iter->fOpsPerSec << ","
+				  << iter->iThreads << ","
+				  << iter->fTiledMeanMs << ","
+				  << iter->fSpeedup << std::endl;
+	}
+}
+
+static void print_json (const std::vector<BenchResult>& results)
+{
+	std::cout << "[" << std::endl;
+
+	for (std::vector<BenchResult>::const_iterator iter = results.begin ();
+		 iter != results.end ();
+		 iter++)
+	{
+		std::cout << "  { \"width\": " << iter->size.iWidth
+				  << ", \"height\": " << iter->size.iHeight
+				  << ", \"sample\": \"" << iter->strSample << "\""
+				  << ", \"steps\": " << iter->iSteps
+				  << ", \"mean_ms\": " << iter->fMeanMs
+				  << ", \"p99_ms\": " << iter->fP99Ms
+				  << ", \"ops_per_sec\": " << iter->fOpsPerSec
+				  << ", \"threads\": " << iter->iThreads
+				  << ", \"tiled_mean_ms\": " << iter->fTiledMeanMs
+				  << ", \"speedup\": " << iter->fSpeedup
+				  << " }" << (iter + 1 != results.end () ? "," : "")
+				  << std::endl;
+	}
+
+	std::cout << "]" << std::endl;
+}
+
+int main (int argc, char** argv)
+{
+	std::vector<BenchSize> sizes;
+	std::vector<BenchResult> results;
+	std::string strSampleName;
+	bool bJSON = false;
+	bool bReplayCache = false;
+	int iSteps = 100;
+	int iStepMs = 25;
+	int iThreads = 0;
+	int i;
+
+	parse_sizes ("512x512", &sizes);
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp (argv[i], "--steps") && i + 1 < argc)
+			iSteps = atoi (argv[++i]);
+		else if (!strcmp (argv[i], "--step-ms") && i + 1 < argc)
+			iStepMs = atoi (argv[++i]);
+		else if (!strcmp (argv[i], "--sizes") && i + 1 < argc)
+		{
+			if (!parse_sizes (argv[++i], &sizes))
+			{
+				std::cerr << "bad size-list \"" << argv[i] << "\"" << std::endl;
+				return 1;
+			}
+		}
+		else if (!strcmp (argv[i], "--threads") && i + 1 < argc)
+			iThreads = atoi (argv[++i]);
+		else if (!strcmp (argv[i], "--sample") && i + 1 < argc)
+			strSampleName = argv[++i];
+		else if (!strcmp (argv[i], "--replay-cache"))
+			bReplayCache = true;
+		else if (!strcmp (argv[i], "--json"))
+			bJSON = true;
+		else if (!strcmp (argv[i], "--csv"))
+			bJSON = false;
+		else
+		{
+			std::cout << "Usage: " << argv[0] << std::endl
+					  << "\t--steps <int> (animation-steps per sample, default: 100)" << std::endl
+					  << "\t--step-ms <int> (milliseconds per step, default: 25)" << std::endl
+					  << "\t--sizes <w>x<h>[,<w>x<h>...] (default: 512x512)" << std::endl
+					  << "\t--sample <name> (only run this sample)" << std::endl
+					  << "\t--threads <int> (also render tiled with this many threads" << std::endl
+					  << "\t                 and report the speedup, default: one per CPU)" << std::endl
+					  << "\t--replay-cache (replay unchanged samples from a raster," << std::endl
+					  << "\t                which is off to measure the drawing itself)" << std::endl
+					  << "\t--csv | --json (output-format, default: csv)" << std::endl;
+			return strcmp (argv[i], "--help") ? 1 : 0;
+		}
+	}
+
+	if (iSteps < 1)
+		iSteps = 1;
+
+	g_type_init ();
+
+	TiledRenderer tiledRenderer (iThreads);
+
+	for (std::vector<BenchSize>::iterator iter = sizes.begin ();
+		 iter != sizes.end ();
+		 iter++)
+	{
+		CairoSamples names;
+
+		for (i = 0; i < CairoSamples::NumberOfSamples; i++)
+		{
+			CairoSamples::Sample sample = (CairoSamples::Sample) i;
+
+			if (!strSampleName.empty () &&
+				strSampleName != names.get_sample_name (sample))
+				continue;
+
+			results.push_back (run_sample (sample,
+										  *iter,
+										  iSteps,
+										  iStepMs,
+										  &tiledRenderer,
+										  bReplayCache));
+		}
+	}
+
+	if (bJSON)
+		print_json (results);
+	else
+		print_csv (results);
+
+	return 0;
+}
@@ -19,40 +19,26 @@
 
 #include <math.h>
 #include <iostream>
+#include <sstream>
 #include <svg-cairo.h>
 #include <sys/time.h>
+#include <sys/stat.h>
 
 #include "cairo-samples.h"
+#include "image-cache.h"
+
+#define CAIRO_LOGO_FILE_NAME "./cairo_logo.svg"
+#define BG_SVG_FILE_NAME "freedesktop.svg"
 
 CairoSamples::CairoSamples ()
 {
-	// initialize animation-variables
-	m_center.x = 0.5f;
-	m_center.y = 0.5f;
-	m_point1.x = 0.1f;
-	m_point1.y = 0.2f;
-	m_point2.x = 0.5f;
-	m_point2.y = 0.5f;
-	m_point3.x = 0.8f;
-	m_point3.y = 0.4f;
-	m_point4.x = 0.2f;
-	m_point4.y = 0.9f;
-	m_fRadius = 0.25f;
-	m_fAngle1 = 0.0f;
-	m_fAngle2 = 360.0f;
-	m_centerXStep = 0.0025f;
-	m_centerYStep = 0.0025f;
-	m_point1XStep = -0.0025f;
-	m_point1YStep = -0.0025f;
-	m_point2XStep = 0.0025f;
-	m_point2YStep = -0.0025f;
-	m_point2XStep = 0.0025f;
-	m_point3YStep = -0.0025f;
-	m_point4XStep = 0.0025f;
-	m_point4YStep = -0.0025f;
-	m_fRadiusStep = 0.0025f;
-	m_fAngle1Step = 0.5f;
-	m_fAngle2Step = -1.5f;
+	m_pSharedAnimation = NULL;
+	m_iAnimationInstance = 0;
+	m_ulMilliSeconds = 0;
+	m_bReplayCache = true;
+	m_ulAnimationStep = 0;
+	m_bWaitForImages = true;
+	m_bImagePending = false;
 
 	// setup sample-entry list
 	Entry* pEntry = new Entry;
@@ -142,105 +128,36 @@ CairoSamples::CairoSamples ()
 
 CairoSamples::~CairoSamples ()
 {
+	while (!m_svgCache.empty ())
+		drop_svg (m_svgCache.begin ()->first);
 }
 
+// a step coming late only moves things further, but after the animation was
+// paused (or the clock started over) it shouldn't jump
+#define MAX_ANIMATION_DELTA 100
+
 void CairoSamples::do_animation_step (unsigned long ulMilliSeconds)
 {
-	srand (42);
+	unsigned long ulDelta = 0;
+
+	if (ulMilliSeconds > m_ulMilliSeconds)
+		ulDelta = ulMilliSeconds - m_ulMilliSeconds;
+	if (ulDelta > MAX_ANIMATION_DELTA)
+		ulDelta = MAX_ANIMATION_DELTA;
 
 	m_ulMilliSeconds = ulMilliSeconds;
+	m_ulAnimationStep++;
+
+	// shared channels are advanced by whoever owns them
+	if (!m_pSharedAnimation)
+		m_animation.advance (ulDelta / 1000.0f);
+}
 
-	// update vars
-	update_var (&m_center.x,
-				0.0f,
-				1.0f,
-				&m_centerXStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_center.y,
-				0.0f,
-				1.0f,
-				&m_centerYStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point1.x,
-				0.0f,
-				1.0f,
-				&m_point1XStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point1.y,
-				0.0f,
-				1.0f,
-				&m_point1YStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point2.x,
-				0.0f,
-				1.0f,
-				&m_point2XStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point2.y,
-				0.0f,
-				1.0f,
-				&m_point2YStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point3.x,
-				0.0f,
-				1.0f,
-				&m_point3XStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point3.y,
-				0.0f,
-				1.0f,
-				&m_point3YStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point4.x,
-				0.0f,
-				1.0f,
-				&m_point4XStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_point4.y,
-				0.0f,
-				1.0f,
-				&m_point4YStep,
-				(double) rand() * 0.025 / RAND_MAX,
-				(double) rand() * -0.025 / RAND_MAX);
-
-	update_var (&m_fRadius,
-				0.05f,
-				0.5f,
-				&m_fRadiusStep,
-				(double) rand() * 0.0125 / RAND_MAX,
-				(double) rand() * -0.0125 / RAND_MAX);
-
-	update_var (&m_fAngle1,
-				0.0f,
-				360.0f,
-				&m_fAngle1Step,
-				0.5f,
-				-1.0f);
-
-	update_var (&m_fAngle2,
-				0.0f,
-				360.0f,
-				&m_fAngle2Step,
-				2.0f,
-				-0.75f);
+void CairoSamples::set_animation (const AnimationChannels* pAnimation,
+								  int iInstance)
+{
+	m_pSharedAnimation = pAnimation;
+	m_iAnimationInstance = pAnimation ? iInstance : 0;
 }
 
 void CairoSamples::set_context (Cairo::Context* pCairoContext)
@@ -255,21 +172,277 @@ void CairoSamples::normalize_canvas (double fWidth, double fHeight) const
 
 void CairoSamples::set_bg_svg (std::string strSVGFileName)
 {
-	unsigned int uiWidth;
-	unsigned int uiHeight;
-	svg_cairo_t* pSVGContext;
-
-	svg_cairo_create (&pSVGContext);
-	svg_cairo_parse (pSVGContext, strSVGFileName.c_str ());
-	svg_cairo_get_size (pSVGContext, &uiWidth, &uiHeight);
 	m_pCairoContext->save ();
-	m_pCairoContext->scale (1.0f / uiWidth, 1.0f / uiHeight);
-	svg_cairo_render (pSVGContext, m_pCairoContext->cobj ());
+	render_svg (strSVGFileName);
 	m_pCairoContext->restore ();
-	svg_cairo_destroy (pSVGContext);
 }
 
+void CairoSamples::set_replay_cache (bool bReplayCache)
+{
+	m_bReplayCache = bReplayCache;
+	if (!m_bReplayCache)
+		m_sampleCache.flush ();
+}
+
+void CairoSamples::set_wait_for_images (bool bWaitForImages)
+{
+	m_bWaitForImages = bWaitForImages;
+}
+
+CairoSamples::SampleCache::~SampleCache ()
+{
+	flush ();
+}
+
+void CairoSamples::SampleCache::flush ()
+{
+	for (iterator iter = begin (); iter != end (); iter++)
+		if (iter->second.pRaster)
+			cairo_surface_destroy (iter->second.pRaster);
+	clear ();
+}
+
+// drops every raster but the one of sample
+void CairoSamples::SampleCache::flush_others (Sample sample)
+{
+	iterator iter = begin ();
+
+	while (iter != end ())
+	{
+		if (iter->first == sample)
+		{
+			iter++;
+			continue;
+		}
+
+		if (iter->second.pRaster)
+			cairo_surface_destroy (iter->second.pRaster);
+		erase (iter++);
+	}
+}
+
+bool CairoSamples::SampleKey::operator== (const SampleKey& other) const
+{
+	return iWidth == other.iWidth &&
+		   iHeight == other.iHeight &&
+		   ulAnimationStep == other.ulAnimationStep &&
+		   pAnimation == other.pAnimation &&
+		   iAnimationInstance == other.iAnimationInstance &&
+		   ulAnimationGeneration == other.ulAnimationGeneration &&
+		   cairoCapStyle == other.cairoCapStyle &&
+		   cairoJoinStyle == other.cairoJoinStyle &&
+		   dashStyle == other.dashStyle &&
+		   cairoOperator == other.cairoOperator &&
+		   cairoExtendMode == other.cairoExtendMode &&
+		   cairoFilterMode == other.cairoFilterMode &&
+		   fLineWidth == other.fLineWidth &&
+		   ausBgColor[0] == other.ausBgColor[0] &&
+		   ausBgColor[1] == other.ausBgColor[1] &&
+		   ausBgColor[2] == other.ausBgColor[2] &&
+		   strFontFamily == other.strFontFamily &&
+		   fFontSize == other.fFontSize &&
+		   cairoFontWeight == other.cairoFontWeight &&
+		   cairoFontSlant == other.cairoFontSlant &&
+		   strSomeText == other.strSomeText &&
+		   strImageFileName == other.strImageFileName &&
+		   strSvgFileName == other.strSvgFileName &&
+		   fileMTime == other.fileMTime;
+}
+
+// the samples that draw the same every time for the same parameters (and
+// files on disk); the clock follows the wall-clock and the moving ones
+// depend on the animation
+bool CairoSamples::sample_is_static (Sample sample)
+{
+	switch (sample)
+	{
+		case Clock :
+		case MovingArc :
+		case MovingArcNegative :
+		case MovingCairoLogo :
+		case MovingClip :
+		case MovingClipImage :
+		case MovingCurveTo :
+		case MovingGradient :
+		case MovingGradient2 :
+		case MovingZini :
+			return false;
+
+		default :
+			return true;
+	}
+}
+
+void CairoSamples::get_sample_key (Sample sample,
+								   int iWidth,
+								   int iHeight,
+								   SampleKey* pKey)
+{
+	std::string strFileName;
+	struct stat fileInfo;
+
+	pKey->iWidth = iWidth;
+	pKey->iHeight = iHeight;
+	if (sample_is_static (sample))
+	{
+		pKey->ulAnimationStep = 0;
+		pKey->pAnimation = NULL;
+		pKey->iAnimationInstance = 0;
+		pKey->ulAnimationGeneration = 0;
+	}
+	else
+	{
+		pKey->ulAnimationStep = m_ulAnimationStep;
+		pKey->pAnimation = &get_animation ();
+		pKey->iAnimationInstance = m_iAnimationInstance;
+		pKey->ulAnimationGeneration = get_animation ().get_generation ();
+	}
+	pKey->cairoCapStyle = m_cairoCapStyle;
+	pKey->cairoJoinStyle = m_cairoJoinStyle;
+	pKey->dashStyle = m_dashStyle;
+	pKey->cairoOperator = m_cairoOperator;
+	pKey->cairoExtendMode = m_cairoExtendMode;
+	pKey->cairoFilterMode = m_cairoFilterMode;
+	pKey->fLineWidth = m_fLineWidth;
+	pKey->ausBgColor[0] = m_bgColor.get_red ();
+	pKey->ausBgColor[1] = m_bgColor.get_green ();
+	pKey->ausBgColor[2] = m_bgColor.get_blue ();
+	pKey->strFontFamily = m_strFontFamily;
+	pKey->fFontSize = m_fFontSize;
+	pKey->cairoFontWeight = m_cairoFontWeight;
+	pKey->cairoFontSlant = m_cairoFontSlant;
+	pKey->strSomeText = m_strSomeText;
+	pKey->strImageFileName = m_strImageFileName;
+	pKey->strSvgFileName = m_strSvgFileName;
+
+	// a file edited on disk is drawn anew, like the SVG- and image-caches
+	// notice it
+	switch (sample)
+	{
+		case Image :
+		case ImagePattern :
+		case MovingClipImage :
+			strFileName = m_strImageFileName;
+		break;
+
+		case LibSVG :
+			strFileName = m_strSvgFileName;
+		break;
+
+		case MovingCairoLogo :
+			strFileName = CAIRO_LOGO_FILE_NAME;
+		break;
+
+		default :
+		break;
+	}
+
+	pKey->fileMTime = 0;
+	if (!strFileName.empty () && stat (strFileName.c_str (), &fileInfo) == 0)
+		pKey->fileMTime = fileInfo.st_mtime;
+}
+
+// the current transformation is the normalized canvas
+void CairoSamples::blit_raster (cairo_surface_t* pRaster, int iWidth, int iHeight)
+{
+	cairo_t* pContext = m_pCairoContext->cobj ();
+
+	cairo_save (pContext);
+	cairo_scale (pContext, 1.0f / iWidth, 1.0f / iHeight);
+	cairo_set_source_surface (pContext, pRaster, 0.0f, 0.0f);
+	cairo_rectangle (pContext, 0.0f, 0.0f, iWidth, iHeight);
+	cairo_fill (pContext);
+	cairo_restore (pContext);
+}
+
+// every sample covers the whole canvas with an opaque background first, so
+// its output can be kept as a raster and replayed with a single blit. Static
+// samples are recorded right away. Animated ones only once the same key
+// comes up a second time, which is when the animation is turned off, so they
+// don't pay for recording while they move. Switching to another sample drops
+// the raster of the previous one
 bool CairoSamples::do_sample (Sample sample)
+{
+	cairo_matrix_t matrix;
+	SampleKey key;
+	SampleRaster* pEntry;
+	Cairo::Context* pCairoContext;
+	cairo_t* pRasterContext;
+	bool bResult;
+	int iWidth;
+	int iHeight;
+
+	if (!m_bReplayCache || !m_pCairoContext || sample == Clock)
+		return draw_sample (sample);
+
+	// only for a plain upright canvas on whole pixels, like main.cpp and
+	// the tiles of TiledRenderer have it
+	cairo_get_matrix (m_pCairoContext->cobj (), &matrix);
+	iWidth = (int) matrix.xx;
+	iHeight = (int) matrix.yy;
+	if (matrix.xy != 0.0f || matrix.yx != 0.0f ||
+		matrix.xx != iWidth || matrix.yy != iHeight ||
+		matrix.x0 != floor (matrix.x0) || matrix.y0 != floor (matrix.y0) ||
+		iWidth < 1 || iHeight < 1)
+		return draw_sample (sample);
+
+	get_sample_key (sample, iWidth, iHeight, &key);
+	if (m_sampleCache.find (sample) == m_sampleCache.end ())
+	{
+		m_sampleCache.flush_others (sample);
+		m_sampleCache[sample].bKeyValid = false;
+		m_sampleCache[sample].pRaster = NULL;
+	}
+	pEntry = &m_sampleCache[sample];
+	if (pEntry->pRaster && pEntry->bKeyValid && pEntry->key == key)
+	{
+		blit_raster (pEntry->pRaster, iWidth, iHeight);
+		return true;
+	}
+
+	if (!sample_is_static (sample) &&
+		!(pEntry->bKeyValid && pEntry->key == key))
+	{
+		pEntry->key = key;
+		pEntry->bKeyValid = true;
+		if (pEntry->pRaster)
+			cairo_surface_destroy (pEntry->pRaster);
+		pEntry->pRaster = NULL;
+		return draw_sample (sample);
+	}
+
+	if (pEntry->pRaster)
+		cairo_surface_destroy (pEntry->pRaster);
+	pEntry->pRaster = cairo_surface_create_similar (cairo_get_target (m_pCairoContext->cobj ()),
+													CAIRO_CONTENT_COLOR_ALPHA,
+													iWidth,
+													iHeight);
+	pEntry->key = key;
+	pEntry->bKeyValid = true;
+
+	pRasterContext = cairo_create (pEntry->pRaster);
+	cairo_scale (pRasterContext, iWidth, iHeight);
+	pCairoContext = m_pCairoContext;
+	m_pCairoContext = new Cairo::Context (pRasterContext, true);
+	m_bImagePending = false;
+	bResult = draw_sample (sample);
+	delete m_pCairoContext;
+	m_pCairoContext = pCairoContext;
+
+	blit_raster (pEntry->pRaster, iWidth, iHeight);
+
+	// a placeholder is not worth replaying, the image may be there next time
+	if (m_bImagePending)
+	{
+		cairo_surface_destroy (pEntry->pRaster);
+		pEntry->pRaster = NULL;
+		pEntry->bKeyValid = false;
+	}
+
+	return bResult;
+}
+
+bool CairoSamples::draw_sample (Sample sample)
 {
 	bool bResult = false;
 
@@ -300,13 +473,11 @@ bool CairoSamples::do_sample (Sample sample)
 		break;
 
 		case Image :
-			//bResult = image ();
-			bResult = sample_fallback ("Sample disabled");
+			bResult = image ();
 		break;
 
 		case ImagePattern :
-			//bResult = image_pattern ();
-			bResult = sample_fallback ("Sample disabled");
+			bResult = image_pattern ();
 		break;
 
 		case LibSVG :
@@ -330,8 +501,7 @@ bool CairoSamples::do_sample (Sample sample)
 		break;
 
 		case MovingClipImage :
-			//bResult = moving_clip_image ();
-			bResult = sample_fallback ("Sample disabled");
+			bResult = moving_clip_image ();
 		break;
 
 		case MovingCurveTo :
@@ -518,10 +688,16 @@ void CairoSamples::set_some_text (std::string strSomeText)
 void CairoSamples::set_image_file_name (std::string strFileName)
 {
 	m_strImageFileName = strFileName;
+
+	// have it decoded by the time a sample needs it
+	ImageCache::get_default ()->request (m_strImageFileName);
 }
 
 void CairoSamples::set_svg_file_name (std::string strFileName)
 {
+	if (strFileName != m_strSvgFileName)
+		drop_svg (m_strSvgFileName);
+
 	m_strSvgFileName = strFileName;
 }
 
@@ -543,66 +719,237 @@ std::string CairoSamples::get_sample_name (Sample sample)
 	return m_sampleList[sample].name;
 }
 
-void CairoSamples::update_var (double* pfValue,
-							   double fLowerLimit,
-							   double fUpperLimit,
-							   double* pfStep,
-							   double fGrow,
-							   double fShrink)
+// parsing is by far the most expensive part of drawing an SVG, so each file
+// is parsed once and kept until its modification-time changes
+CairoSamples::SvgDocument* CairoSamples::get_svg (std::string strFileName)
 {
-	if (*pfValue <= fLowerLimit)
+	struct stat fileInfo;
+	SvgCache::iterator iter;
+	SvgDocument document;
+
+	if (stat (strFileName.c_str (), &fileInfo) != 0)
 	{
-		*pfValue = fLowerLimit;
-		*pfStep = fGrow;
+		drop_svg (strFileName);
+		return NULL;
 	}
 
-	if (*pfValue >= fUpperLimit)
+	iter = m_svgCache.find (strFileName);
+	if (iter != m_svgCache.end ())
 	{
-		*pfValue = fUpperLimit;
-		*pfStep = fShrink;
+		if (iter->second.mTime == fileInfo.st_mtime)
+			return &iter->second;
+
+		drop_svg (strFileName);
 	}
 
-	*pfValue += *pfStep;
+	svg_cairo_create (&document.pSVGContext);
+	if (svg_cairo_parse (document.pSVGContext, strFileName.c_str ()) !=
+		SVG_CAIRO_STATUS_SUCCESS)
+	{
+		svg_cairo_destroy (document.pSVGContext);
+		return NULL;
+	}
+
+	svg_cairo_get_size (document.pSVGContext,
+						&document.uiWidth,
+						&document.uiHeight);
+	document.mTime = fileInfo.st_mtime;
+	document.pRaster = NULL;
+	document.iRasterWidth = 0;
+	document.iRasterHeight = 0;
+
+	return &(m_svgCache[strFileName] = document);
+}
+
+void CairoSamples::drop_unused_svgs ()
+{
+	SvgCache::iterator iter = m_svgCache.begin ();
+
+	while (iter != m_svgCache.end ())
+	{
+		std::string strFileName = (iter++)->first;
+
+		if (strFileName != m_strSvgFileName &&
+			strFileName != CAIRO_LOGO_FILE_NAME &&
+			strFileName != BG_SVG_FILE_NAME)
+			drop_svg (strFileName);
+	}
+}
+
+void CairoSamples::drop_svg (std::string strFileName)
+{
+	SvgCache::iterator iter;
+
+	iter = m_svgCache.find (strFileName);
+	if (iter == m_svgCache.end ())
+		return;
+
+	if (iter->second.pRaster)
+		cairo_surface_destroy (iter->second.pRaster);
+	svg_cairo_destroy (iter->second.pSVGContext);
+	m_svgCache.erase (iter);
+}
+
+// draws the SVG stretched over the unit-square. As long as that ends up as
+// an upright rectangle on the target, the document is rendered once into a
+// surface of that size and only blitted after that, until the size changes
+void CairoSamples::render_svg (std::string strFileName)
+{
+	SvgDocument* pDocument = get_svg (strFileName);
+	cairo_t* pContext = m_pCairoContext->cobj ();
+	cairo_matrix_t matrix;
+	int iWidth;
+	int iHeight;
+
+	if (!pDocument || !pDocument->uiWidth || !pDocument->uiHeight)
+		return;
+
+	cairo_get_matrix (pContext, &matrix);
+	iWidth = (int) ceil (matrix.xx);
+	iHeight = (int) ceil (matrix.yy);
+	if (matrix.xy != 0.0f || matrix.yx != 0.0f ||
+		iWidth < 1 || iHeight < 1 || iWidth > 4096 || iHeight > 4096)
+	{
+		m_pCairoContext->scale (1.0f / pDocument->uiWidth,
+								1.0f / pDocument->uiHeight);
+		svg_cairo_render (pDocument->pSVGContext, pContext);
+		return;
+	}
+
+	if (!pDocument->pRaster ||
+		pDocument->iRasterWidth != iWidth ||
+		pDocument->iRasterHeight != iHeight)
+	{
+		cairo_t* pRasterContext;
+
+		if (pDocument->pRaster)
+			cairo_surface_destroy (pDocument->pRaster);
+		pDocument->pRaster = cairo_surface_create_similar (cairo_get_target (pContext),
+														   CAIRO_CONTENT_COLOR_ALPHA,
+														   iWidth,
+														   iHeight);
+		pDocument->iRasterWidth = iWidth;
+		pDocument->iRasterHeight = iHeight;
+
+		pRasterContext = cairo_create (pDocument->pRaster);
+		cairo_scale (pRasterContext,
+					 (double) iWidth / pDocument->uiWidth,
+					 (double) iHeight / pDocument->uiHeight);
+		svg_cairo_render (pDocument->pSVGContext, pRasterContext);
+		cairo_destroy (pRasterContext);
+	}
+
+	m_pCairoContext->scale (1.0f / iWidth, 1.0f / iHeight);
+	cairo_set_source_surface (pContext, pDocument->pRaster, 0.0f, 0.0f);
+	cairo_rectangle (pContext, 0.0f, 0.0f, iWidth, iHeight);
+	cairo_fill (pContext);
+}
+
+// the decoded m_strImageFileName, for drawing it over fUserSize x fUserSize
+// units with the current transformation. Unless the filter is one that picks
+// single pixels anyway, a smaller copy is used when that's enough, which is
+// both faster and doesn't alias like sampling the full-size image would
+cairo_surface_t* CairoSamples::get_image (double fUserSize)
+{
+	cairo_matrix_t matrix;
+	double fDeviceWidth = 0.0f;
+	double fDeviceHeight = 0.0f;
+
+	m_bImagePending = false;
+	if (m_cairoFilterMode != CAIRO_FILTER_FAST &&
+		m_cairoFilterMode != CAIRO_FILTER_NEAREST)
+	{
+		cairo_get_matrix (m_pCairoContext->cobj (), &matrix);
+		fDeviceWidth = fUserSize * sqrt (matrix.xx * matrix.xx +
+										 matrix.yx * matrix.yx);
+		fDeviceHeight = fUserSize * sqrt (matrix.xy * matrix.xy +
+										  matrix.yy * matrix.yy);
+	}
+
+	return ImageCache::get_default ()->get (m_strImageFileName,
+											fDeviceWidth,
+											fDeviceHeight,
+											m_bWaitForImages ? NULL : &m_bImagePending);
+}
+
+const AnimationChannels& CairoSamples::get_animation () const
+{
+	return m_pSharedAnimation ? *m_pSharedAnimation : m_animation;
 }
 
 HandlePoint CairoSamples::get_center ()
 {
-	return m_center;
+	HandlePoint center;
+
+	center.x = get_animation ().get (m_iAnimationInstance,
+									 AnimationChannels::CenterX);
+	center.y = get_animation ().get (m_iAnimationInstance,
+									 AnimationChannels::CenterY);
+
+	return center;
 }
 
 HandlePoint CairoSamples::get_point1 ()
 {
-	return m_point1;
+	HandlePoint point;
+
+	point.x = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point1X);
+	point.y = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point1Y);
+
+	return point;
 }
 
 HandlePoint CairoSamples::get_point2 ()
 {
-	return m_point2;
+	HandlePoint point;
+
+	point.x = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point2X);
+	point.y = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point2Y);
+
+	return point;
 }
 
 HandlePoint CairoSamples::get_point3 ()
 {
-	return m_point3;
+	HandlePoint point;
+
+	point.x = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point3X);
+	point.y = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point3Y);
+
+	return point;
 }
 
 HandlePoint CairoSamples::get_point4 ()
 {
-	return m_point4;
+	HandlePoint point;
+
+	point.x = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point4X);
+	point.y = get_animation ().get (m_iAnimationInstance,
+									AnimationChannels::Point4Y);
+
+	return point;
 }
 
 double CairoSamples::get_radius ()
 {
-	return m_fRadius;
+	return get_animation ().get (m_iAnimationInstance, AnimationChannels::Radius);
 }
 
 double CairoSamples::get_angle_1 ()
 {
-	return m_fAngle1;
+	return get_animation ().get (m_iAnimationInstance, AnimationChannels::Angle1);
 }
 
 double CairoSamples::get_angle_2 ()
 {
-	return m_fAngle2;
+	return get_animation ().get (m_iAnimationInstance, AnimationChannels::Angle2);
 }
 
 void CairoSamples::draw_background ()
@@ -684,14 +1031,168 @@ void CairoSamples::draw_handle (double fX, double fY)
 	m_pCairoContext->fill ();
 }
 
+CairoSamples::FontCache::~FontCache ()
+{
+	for (iterator iter = begin (); iter != end (); iter++)
+		cairo_font_face_destroy (iter->second);
+}
+
+CairoSamples::GlyphRunCache::~GlyphRunCache ()
+{
+	flush ();
+}
+
+void CairoSamples::GlyphRunCache::flush ()
+{
+	for (iterator iter = begin (); iter != end (); iter++)
+	{
+		cairo_scaled_font_destroy (iter->first.first);
+		cairo_glyph_free (iter->second.pGlyphs);
+	}
+	clear ();
+}
+
+// looking up a toy font-face goes through fontconfig, so each family, slant
+// and weight is only looked up once and the face is kept
+void CairoSamples::select_font (std::string strFamily,
+								Cairo::FontSlant cairoFontSlant,
+								Cairo::FontWeight cairoFontWeight)
+{
+	cairo_t* pContext = m_pCairoContext->cobj ();
+	std::stringstream key;
+	FontCache::iterator iter;
+
+	key << strFamily << "/" << (int) cairoFontSlant << "/" << (int) cairoFontWeight;
+	iter = m_fontCache.find (key.str ());
+	if (iter != m_fontCache.end ())
+	{
+		cairo_set_font_face (pContext, iter->second);
+		return;
+	}
+
+	cairo_select_font_face (pContext,
+							strFamily.c_str (),
+							cairoFontSlant,
+							cairoFontWeight);
+	m_fontCache[key.str ()] = cairo_font_face_reference (cairo_get_font_face (pContext));
+}
+
+// the glyphs of strText in the context's current scaled font, which stands
+// for face, size and transformation, so shaping happens only once for each;
+// NULL where cairo is too old to hand out glyphs (before 1.8)
+CairoSamples::GlyphRun* CairoSamples::get_glyph_run (std::string strText)
+{
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 8, 0)
+	cairo_scaled_font_t* pScaledFont;
+	cairo_text_extents_t extents;
+	GlyphRunCache::iterator iter;
+	GlyphRun run;
+
+	pScaledFont = cairo_get_scaled_font (m_pCairoContext->cobj ());
+	iter = m_glyphRunCache.find (std::make_pair (pScaledFont, strText));
+	if (iter != m_glyphRunCache.end ())
+		return &iter->second;
+
+	run.pGlyphs = NULL;
+	run.iGlyphs = 0;
+	if (cairo_scaled_font_text_to_glyphs (pScaledFont,
+										  0.0f,
+										  0.0f,
+										  strText.c_str (),
+										  -1,
+										  &run.pGlyphs,
+										  &run.iGlyphs,
+										  NULL,
+										  NULL,
+										  NULL) != CAIRO_STATUS_SUCCESS)
+		return NULL;
+
+	cairo_scaled_font_text_extents (pScaledFont, strText.c_str (), &extents);
+	run.fAdvanceX = extents.x_advance;
+	run.fAdvanceY = extents.y_advance;
+
+	// the text can be edited, so don't let old runs pile up
+	if (m_glyphRunCache.size () >= 64)
+		m_glyphRunCache.flush ();
+
+	cairo_scaled_font_reference (pScaledFont);
+	return &(m_glyphRunCache[std::make_pair (pScaledFont, strText)] = run);
+#else
+	return NULL;
+#endif
+}
+
+// glyphs are positioned in user-space, translating there doesn't change the
+// scaled font, so a run placed at the origin can be drawn anywhere
+void CairoSamples::show_text_run (std::string strText)
+{
+	cairo_t* pContext = m_pCairoContext->cobj ();
+	GlyphRun* pRun = get_glyph_run (strText);
+	double fX;
+	double fY;
+
+	if (!pRun)
+	{
+		m_pCairoContext->show_text (strText);
+		return;
+	}
+
+	cairo_get_current_point (pContext, &fX, &fY);
+	cairo_save (pContext);
+	cairo_translate (pContext, fX, fY);
+	cairo_show_glyphs (pContext, pRun->pGlyphs, pRun->iGlyphs);
+	cairo_restore (pContext);
+	cairo_move_to (pContext, fX + pRun->fAdvanceX, fY + pRun->fAdvanceY);
+}
+
+void CairoSamples::text_path_run (std::string strText)
+{
+	cairo_t* pContext = m_pCairoContext->cobj ();
+	GlyphRun* pRun = get_glyph_run (strText);
+	cairo_matrix_t matrix;
+	double fX;
+	double fY;
+
+	if (!pRun)
+	{
+		m_pCairoContext->text_path (strText);
+		return;
+	}
+
+	// unlike cairo_save/restore, setting the matrix back keeps the path
+	cairo_get_current_point (pContext, &fX, &fY);
+	cairo_get_matrix (pContext, &matrix);
+	cairo_translate (pContext, fX, fY);
+	cairo_glyph_path (pContext, pRun->pGlyphs, pRun->iGlyphs);
+	cairo_set_matrix (pContext, &matrix);
+	cairo_move_to (pContext, fX + pRun->fAdvanceX, fY + pRun->fAdvanceY);
+}
+
+void CairoSamples::text_extents_run (std::string strText,
+									 Cairo::TextExtents& extents)
+{
+	GlyphRun* pRun = get_glyph_run (strText);
+
+	if (!pRun)
+	{
+		m_pCairoContext->text_extents (strText, extents);
+		return;
+	}
+
+	cairo_glyph_extents (m_pCairoContext->cobj (),
+						 pRun->pGlyphs,
+						 pRun->iGlyphs,
+						 &extents);
+}
+
 bool CairoSamples::sample_fallback (std::string strMessage)
 {
 	if (!m_pCairoContext)
 		return false;
 
-	m_pCairoContext->select_font_face ("Sans",
-									   CAIRO_FONT_SLANT_NORMAL,
-									   CAIRO_FONT_WEIGHT_NORMAL);
+	select_font ("Sans",
+				 CAIRO_FONT_SLANT_NORMAL,
+				 CAIRO_FONT_WEIGHT_NORMAL);
 	m_pCairoContext->set_font_size (0.115f);
 
 	Gdk::Color white ("#ffffff");
@@ -699,7 +1200,7 @@ bool CairoSamples::sample_fallback (std::string strMessage)
 
 	m_pCairoContext->set_source_rgb (1.0f, 0.0f, 0.0f);
 	m_pCairoContext->move_to (0.04f, 0.53f);
-	m_pCairoContext->show_text (strMessage.c_str ());
+	show_text_run (strMessage.c_str ());
 
 	return true;
 }
@@ -965,48 +1466,48 @@ bool CairoSamples::fontmania ()
 	std::string theText = "Fontmania";
 
 	// set font-attributes
-	m_pCairoContext->select_font_face ("Times New Roman",
-									   CAIRO_FONT_SLANT_ITALIC,
-									   CAIRO_FONT_WEIGHT_NORMAL);
+	select_font ("Times New Roman",
+				 CAIRO_FONT_SLANT_ITALIC,
+				 CAIRO_FONT_WEIGHT_NORMAL);
 	m_pCairoContext->set_font_size (0.6f);
 
 	// draw the solid black text
 	m_pCairoContext->set_source_rgba (0.0f, 0.0f, 0.0f, 0.15f);
 	m_pCairoContext->move_to (0.05f, 0.6f);
-	m_pCairoContext->show_text (theText);
+	show_text_run (theText);
 
 	// set font-attributes
-	m_pCairoContext->select_font_face ("Arial Black",
-									   CAIRO_FONT_SLANT_NORMAL,
-									   CAIRO_FONT_WEIGHT_NORMAL);
+	select_font ("Arial Black",
+				 CAIRO_FONT_SLANT_NORMAL,
+				 CAIRO_FONT_WEIGHT_NORMAL);
 	m_pCairoContext->set_font_size (0.1f);
 
 	// draw the solid black text
 	m_pCairoContext->set_source_rgba (0.0f, 0.0f, 0.0f, 1.0f);
 	m_pCairoContext->move_to (0.4f, 0.6f);
-	m_pCairoContext->show_text (theText);
+	show_text_run (theText);
 
 	// set font-attributes
-	m_pCairoContext->select_font_face ("Verdana",
-									   CAIRO_FONT_SLANT_NORMAL,
-									   CAIRO_FONT_WEIGHT_NORMAL);
+	select_font ("Verdana",
+				 CAIRO_FONT_SLANT_NORMAL,
+				 CAIRO_FONT_WEIGHT_NORMAL);
 	m_pCairoContext->set_font_size (0.15f);
 
 	// draw the solid black text
 	m_pCairoContext->set_source_rgba (0.0f, 0.0f, 0.0f, 0.25f);
 	m_pCairoContext->move_to (0.1f, 0.6f);
-	m_pCairoContext->show_text (theText);
+	show_text_run (theText);
 
 	// set font-attributes
-	m_pCairoContext->select_font_face ("Impact",
-									   CAIRO_FONT_SLANT_NORMAL,
-									   CAIRO_FONT_WEIGHT_NORMAL);
+	select_font ("Impact",
+				 CAIRO_FONT_SLANT_NORMAL,
+				 CAIRO_FONT_WEIGHT_NORMAL);
 	m_pCairoContext->set_font_size (0.2f);
 
 	// draw the solid black text
 	m_pCairoContext->set_source_rgba (0.0f, 0.0f, 0.0f, 0.35f);
 	m_pCairoContext->move_to (0.3f, 0.6f);
-	m_pCairoContext->show_text (theText);
+	show_text_run (theText);
 
 	return true;
 }
@@ -1038,24 +1539,30 @@ bool CairoSamples::image ()
 	if (!m_pCairoContext)
 		return false;
 
-	draw_background ();
-	std::string bla;
-	bla.assign (m_strImageFileName);
-
+	cairo_t* pContext = m_pCairoContext->cobj ();
+	cairo_surface_t* pImage;
 	int iWidth;
 	int iHeight;
-	Cairo::Surface image = Cairo::Surface::create (CAIRO_FORMAT_RGB24, 1, 1);
-	//image.create_from_png (bla.c_str ());
-	iWidth = image.get_width ();
-	iHeight = image.get_height ();
+
+	draw_background ();
+
+	// the rotation doesn't change the size the image ends up at
+	pImage = get_image (1.0f);
+	if (!pImage)
+		return sample_fallback (m_bImagePending ? "Loading image..." : "Image not found");
+
+	iWidth = cairo_image_surface_get_width (pImage);
+	iHeight = cairo_image_surface_get_height (pImage);
 
 	m_pCairoContext->translate (0.5f, 0.5f);
 	m_pCairoContext->rotate (45.0f * M_PI / 180.0f);
 	m_pCairoContext->scale (1.0f / iWidth, 1.0f / iHeight);
 	m_pCairoContext->translate (-0.5f * iWidth, -0.5f * iHeight);
 
-	m_pCairoContext->set_source_surface (image, 0.0f, 0.0f);
+	cairo_set_source_surface (pContext, pImage, 0.0f, 0.0f);
+	cairo_pattern_set_filter (cairo_get_source (pContext), m_cairoFilterMode);
 	m_pCairoContext->paint ();
+	cairo_surface_destroy (pImage);
 
 	return true;
 }
@@ -1065,17 +1572,23 @@ bool CairoSamples::image_pattern ()
 	if (!m_pCairoContext)
 		return false;
 
-	draw_background ();
-
 	int iWidth;
 	int iHeight;
-	Cairo::Surface image = Cairo::Surface::create (CAIRO_FORMAT_RGB24, 1, 1);
-	Cairo::Pattern pattern = Cairo::Pattern::create_for_surface (image.cobj ());
+	cairo_surface_t* pImage;
 	cairo_matrix_t matrix;
 
-	//image.create_from_png (m_strImageFileName.c_str ());
-	iWidth = image.get_width ();
-	iHeight = image.get_height ();
+	draw_background ();
+
+	// one tile is a fifth of the unit-square, which is scaled down by
+	// sqrt (2) below
+	pImage = get_image (1.0f / (5.0f * sqrt (2.0f)));
+	if (!pImage)
+		return sample_fallback (m_bImagePending ? "Loading image..." : "Image not found");
+
+	Cairo::Pattern pattern = Cairo::Pattern::create_for_surface (pImage);
+	iWidth = cairo_image_surface_get_width (pImage);
+	iHeight = cairo_image_surface_get_height (pImage);
+	cairo_surface_destroy (pImage);
 
 	pattern.set_extend (m_cairoExtendMode);
 	pattern.set_filter (m_cairoFilterMode);
@@ -1101,19 +1614,7 @@ bool CairoSamples::libsvg ()
 		return false;
 
 	draw_background ();
-
-	svg_cairo_t* pSVGContext;
-	unsigned int uiWidth;
-	unsigned int uiHeight;
-
-	svg_cairo_create (&pSVGContext);
-
-	svg_cairo_parse (pSVGContext, m_strSvgFileName.c_str ());
-	svg_cairo_get_size (pSVGContext, &uiWidth, &uiHeight);
-	m_pCairoContext->scale (1.0f / uiWidth, 1.0f / uiHeight);
-	svg_cairo_render (pSVGContext, m_pCairoContext->cobj ());
-
-	svg_cairo_destroy (pSVGContext);
+	render_svg (m_strSvgFileName);
 
 	return true;
 }
@@ -1211,15 +1712,20 @@ bool CairoSamples::moving_cairo_logo ()
 
 	draw_background ();
 
+	SvgDocument* pDocument = get_svg (CAIRO_LOGO_FILE_NAME);
 	svg_cairo_t* pSVGContext;
 	unsigned int uiWidth;
 	unsigned int uiHeight;
 	cairo_matrix_t matrix;
 	HandlePoint offset = get_center ();
-	
-	svg_cairo_create (&pSVGContext);
-	svg_cairo_parse (pSVGContext, "./cairo_logo.svg");
-	svg_cairo_get_size (pSVGContext, &uiWidth, &uiHeight);
+
+	if (!pDocument)
+		return sample_fallback ("no cairo_logo.svg");
+
+	// the logo is drawn rotated, so only the parsed document is reused
+	pSVGContext = pDocument->pSVGContext;
+	uiWidth = pDocument->uiWidth;
+	uiHeight = pDocument->uiHeight;
 	m_pCairoContext->scale (1.0f / uiWidth, 1.0f / uiHeight);
 
 	cairo_matrix_init_identity (&matrix);
@@ -1270,8 +1776,6 @@ bool CairoSamples::moving_cairo_logo ()
 	m_pCairoContext->paint_with_alpha (0.5f);
 	svg_cairo_render (pSVGContext, m_pCairoContext->cobj ());
 
-	svg_cairo_destroy (pSVGContext);
-
 	return true;
 }
 
@@ -1319,14 +1823,19 @@ bool CairoSamples::moving_clip_image ()
 	if (!m_pCairoContext)
 		return false;
 
+	cairo_t* pContext = m_pCairoContext->cobj ();
 	int iWidth;
 	int iHeight;
-	Cairo::Surface* image;
+	cairo_surface_t* pImage;
 	HandlePoint center = get_center ();
 	double fRadius = get_radius () / 2.0f;
 	HandlePoint handle = {center.x + fRadius * cos (0.0f),
 						  center.y + fRadius * sin (0.0f)};
 
+	pImage = get_image (1.0f);
+	if (!pImage)
+		return sample_fallback (m_bImagePending ? "Loading image..." : "Image not found");
+
 	draw_background ();
 
 	// draw clipping arc/circle
@@ -1335,18 +1844,17 @@ bool CairoSamples::moving_clip_image ()
 
 	// fill that clipping arc/circle with an image
 	m_pCairoContext->new_path ();
-	//image.create_from_png (m_strImageFileName.c_str ());
-	iWidth = image->get_width ();
-	iHeight = image->get_height ();
+	iWidth = cairo_image_surface_get_width (pImage);
+	iHeight = cairo_image_surface_get_height (pImage);
 
+	m_pCairoContext->save ();
 	m_pCairoContext->scale (1.0f / iWidth, 1.0f / iHeight);
 
-	m_pCairoContext->set_source_surface (*image, 0.0f, 0.0f);
+	cairo_set_source_surface (pContext, pImage, 0.0f, 0.0f);
+	cairo_pattern_set_filter (cairo_get_source (pContext), m_cairoFilterMode);
 	m_pCairoContext->paint ();
-
-	//delete image;
-
-	//m_pCairoContext->scale (iWidth, iHeight);
+	m_pCairoContext->restore ();
+	cairo_surface_destroy (pImage);
 
 	// draw the two handle-points
 	draw_handle (&handle);
@@ -1488,7 +1996,7 @@ bool CairoSamples::operator_add ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_ADD);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1510,7 +2018,7 @@ bool CairoSamples::operator_atop ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_ATOP);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1532,7 +2040,7 @@ bool CairoSamples::operator_atop_reverse ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_DEST_ATOP);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1554,7 +2062,7 @@ bool CairoSamples::operator_in ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_IN);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1576,7 +2084,7 @@ bool CairoSamples::operator_in_reverse ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_DEST_IN);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1598,7 +2106,7 @@ bool CairoSamples::operator_out ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_OUT);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1620,7 +2128,7 @@ bool CairoSamples::operator_out_reverse ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_DEST_OUT);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1642,7 +2150,7 @@ bool CairoSamples::operator_over ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_OVER);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1664,7 +2172,7 @@ bool CairoSamples::operator_over_reverse ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_DEST_OVER);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1686,7 +2194,7 @@ bool CairoSamples::operator_saturate ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_SATURATE);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1708,7 +2216,7 @@ bool CairoSamples::operator_xor ()
 
 	draw_background ();
 
-	set_bg_svg ("freedesktop.svg");
+	set_bg_svg (BG_SVG_FILE_NAME);
 	m_pCairoContext->set_operator (CAIRO_OPERATOR_XOR);
 	m_pCairoContext->set_source_rgba (1.0f, 0.0f, 0.0f, 0.5f);
 	m_pCairoContext->rectangle (0.2f, 0.2f, 0.5f, 0.5f);
@@ -1764,16 +2272,15 @@ bool CairoSamples::pattern_fill ()
 	double x;
 	double y;
 	Cairo::TextExtents extents;
-
-	srand (45);
+	FastRandom random (45);
 	m_pCairoContext->set_line_width (m_fLineWidth);
 
 	for (i = 0; i < SPIKES * 2; i++)
 	{
 		x = 0.5f + cos (M_PI * i / SPIKES) * X_INNER_RADIUS +
-		(double) rand() * X_FUZZ / RAND_MAX;
+		random.next_double () * X_FUZZ;
 		y = 0.5f + sin (M_PI * i / SPIKES) * Y_INNER_RADIUS +
-		(double) rand() * Y_FUZZ / RAND_MAX;
+		random.next_double () * Y_FUZZ;
 
 		if (i == 0)
 			m_pCairoContext->move_to (x, y);
@@ -1783,9 +2290,9 @@ bool CairoSamples::pattern_fill ()
 		i++;
 
 		x = 0.5f + cos (M_PI * i / SPIKES) * X_OUTER_RADIUS +
-		(double) rand() * X_FUZZ / RAND_MAX;
+		random.next_double () * X_FUZZ;
 		y = 0.5f + sin (M_PI * i / SPIKES) * Y_OUTER_RADIUS +
-		(double) rand() * Y_FUZZ / RAND_MAX;
+		random.next_double () * Y_FUZZ;
 
 		m_pCairoContext->line_to (x, y);
 	}
@@ -1794,15 +2301,15 @@ bool CairoSamples::pattern_fill ()
 	m_pCairoContext->set_source_rgb (1.0f, 0.0f, 0.0f);
 	m_pCairoContext->stroke ();
 
-	m_pCairoContext->select_font_face (m_strFontFamily,
-									   m_cairoFontSlant,
-									   m_cairoFontWeight);
+	select_font (m_strFontFamily,
+				 m_cairoFontSlant,
+				 m_cairoFontWeight);
 
 	m_pCairoContext->move_to (x, y);
-	m_pCairoContext->text_path (m_strSomeText);
+	text_path_run (m_strSomeText);
 
 	m_pCairoContext->set_font_size (0.2f);
-	m_pCairoContext->text_extents (m_strSomeText, extents);
+	text_extents_run (m_strSomeText, extents);
 	x = 0.5f - (extents.width / 2.0f + extents.x_bearing);
 	y = 0.5f - (extents.height / 2.0f + extents.y_bearing);
 
@@ -1810,7 +2317,7 @@ bool CairoSamples::pattern_fill ()
 	m_pCairoContext->fill ();
 
 	m_pCairoContext->move_to (x, y);
-	m_pCairoContext->text_path (m_strSomeText);
+	text_path_run (m_strSomeText);
 	m_pCairoContext->set_source_rgb (0.0f, 0.0f, 0.0f);
 	m_pCairoContext->stroke ();
 
@@ -1942,14 +2449,14 @@ bool CairoSamples::text_align_center ()
 	draw_background ();
 
 	// set font-attributes
-	m_pCairoContext->select_font_face (m_strSomeText,
-									   m_cairoFontSlant,
-									   m_cairoFontWeight);
+	select_font (m_strSomeText,
+				 m_cairoFontSlant,
+				 m_cairoFontWeight);
 	m_pCairoContext->set_font_size (m_fFontSize);
 
 	// get texts extents
 	Cairo::TextExtents extents;
-	m_pCairoContext->text_extents (m_strSomeText, extents);
+	text_extents_run (m_strSomeText, extents);
 
 	// determine center point
 	double fX;
@@ -1960,7 +2467,7 @@ bool CairoSamples::text_align_center ()
 	// draw the solid black text
 	m_pCairoContext->set_source_rgb (0.0f, 0.0f, 0.0f);
 	m_pCairoContext->move_to (fX, fY);
-	m_pCairoContext->show_text (m_strSomeText.c_str ());
+	show_text_run (m_strSomeText.c_str ());
 
 	// draw helping lines
 	m_pCairoContext->set_line_width (0.005f);
@@ -1986,19 +2493,19 @@ bool CairoSamples::text ()
 
 	// set font-attributes
 	m_pCairoContext->set_line_width (m_fLineWidth);
-	m_pCairoContext->select_font_face (m_strFontFamily,
-									   m_cairoFontSlant,
-									   m_cairoFontWeight);
+	select_font (m_strFontFamily,
+				 m_cairoFontSlant,
+				 m_cairoFontWeight);
 	m_pCairoContext->set_font_size (m_fFontSize);
 
 	// draw the solid black text
 	m_pCairoContext->set_source_rgb (0.0f, 0.0f, 0.0f);
 	m_pCairoContext->move_to (0.04f, 0.53f);
-	m_pCairoContext->show_text (m_strSomeText);
+	show_text_run (m_strSomeText);
 
 	// draw the blue colored text with black outlines
 	m_pCairoContext->move_to (0.27f, 0.65f);
-	m_pCairoContext->text_path (m_strSomeText);
+	text_path_run (m_strSomeText);
 	m_pCairoContext->set_source_rgb (0.5f, 0.5f, 1.0f);
 	m_pCairoContext->fill_preserve ();
 	m_pCairoContext->set_source_rgb (0.0f, 0.0f, 0.0f);
@@ -2020,14 +2527,14 @@ bool CairoSamples::text_extents ()
 	draw_background ();
 
 	// set font-attributes
-	m_pCairoContext->select_font_face (m_strFontFamily.c_str (),
-									   m_cairoFontSlant,
-									   m_cairoFontWeight);
+	select_font (m_strFontFamily.c_str (),
+				 m_cairoFontSlant,
+				 m_cairoFontWeight);
 	m_pCairoContext->set_font_size (m_fFontSize);
 
 	// get texts extents
 	Cairo::TextExtents extents;
-	m_pCairoContext->text_extents (m_strSomeText.c_str (), extents);
+	text_extents_run (m_strSomeText.c_str (), extents);
 
 	double fX = 0.1f;
 	double fY = 0.6f;
@@ -2035,7 +2542,7 @@ bool CairoSamples::text_extents ()
 	// draw the solid black text
 	m_pCairoContext->set_source_rgb (0.0f, 0.0f, 0.0f);
 	m_pCairoContext->move_to (fX, fY);
-	m_pCairoContext->show_text (m_strSomeText.c_str ());
+	show_text_run (m_strSomeText.c_str ());
 
 	// draw helping lines
 	m_pCairoContext->set_line_width (0.005f);
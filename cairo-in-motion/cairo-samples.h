@@ -21,10 +21,14 @@
 #define _CAIROSAMPLES_H_
 
 #include <cairomm/cairomm.h>
+#include <svg-cairo.h>
+#include <sys/types.h>
 #include <string>
+#include <map>
 #include <gdkmm.h>
 
 #include "sample-list-store.h"
+#include "animation-channels.h"
 
 typedef struct _HandlePoint
 {
@@ -98,7 +102,20 @@ class CairoSamples
 			DashedFunky
 		};
 
+		// moves the animation on to ulMilliSeconds, by the time passed since
+		// the last step and not by a fixed amount per call
 		void do_animation_step (unsigned long ulMilliSeconds);
+
+		// draw with instance iInstance of a set of channels someone else
+		// advances, e.g. to animate a lot of samples at once, or pass NULL
+		// to go back to the own ones
+		void set_animation (const AnimationChannels* pAnimation,
+							int iInstance);
+		void set_replay_cache (bool bReplayCache);
+
+		// by default the image-samples wait for the image to be decoded,
+		// without waiting they draw a placeholder until ImageCache is done
+		void set_wait_for_images (bool bWaitForImages);
 		void set_context (Cairo::Context* pCairoContext);
 		void normalize_canvas (double fWidth, double fHeight) const;
 		void set_bg_svg (std::string strSVGFileName);
@@ -121,13 +138,151 @@ class CairoSamples
 		void add_samples_to_list_store (SampleListStore* pSampleListStore);
 		std::string get_sample_name (Sample sample);
 
+		// an assigned CairoSamples keeps its own parsed SVGs, so it doesn't
+		// see set_svg_file_name () dropping the old one. This drops every
+		// SVG no sample draws any more
+		void drop_unused_svgs ();
+
 	private:
-		void update_var (double* pfValue,
-						 double fLowerLimit,
-						 double fUpperLimit,
-						 double* pfStep,
-						 double fGrow,
-						 double fShrink);
+		// the same names in every instance, so assigning one CairoSamples
+		// to another (e.g. every frame for each TiledRenderer worker)
+		// leaves them alone
+		class SampleList : public std::vector<Entry>
+		{
+			public:
+				SampleList () {}
+				SampleList (const SampleList& other) : std::vector<Entry> (other) {}
+				SampleList& operator= (const SampleList& other) { return *this; }
+		};
+
+		// a parsed SVG-document, kept until its file changes on disk, and
+		// optionally a rasterized copy at the device-size it was last drawn
+		typedef struct _SvgDocument
+		{
+			svg_cairo_t*		pSVGContext;
+			time_t				mTime;
+			unsigned int		uiWidth;
+			unsigned int		uiHeight;
+			cairo_surface_t*	pRaster;
+			int					iRasterWidth;
+			int					iRasterHeight;
+		} SvgDocument;
+
+		// libsvg-cairo keeps rendering-state in a parsed document, so they
+		// can't be shared between instances drawing on different threads, a
+		// copied or assigned CairoSamples keeps (or starts with) its own
+		class SvgCache : public std::map<std::string, SvgDocument>
+		{
+			public:
+				SvgCache () {}
+				SvgCache (const SvgCache& other) {}
+				SvgCache& operator= (const SvgCache& other) { return *this; }
+		};
+
+		// everything a sample's output depends on besides the canvas-size,
+		// the animation-fields are only set for samples that are animated.
+		// Shared channels move without do_animation_step (), hence their
+		// generation
+		typedef struct _SampleKey
+		{
+			int							iWidth;
+			int							iHeight;
+			unsigned long				ulAnimationStep;
+			const AnimationChannels*	pAnimation;
+			int							iAnimationInstance;
+			unsigned long				ulAnimationGeneration;
+			Cairo::LineCap				cairoCapStyle;
+			Cairo::LineJoin				cairoJoinStyle;
+			DashStyle					dashStyle;
+			Cairo::Operator				cairoOperator;
+			Cairo::Extend				cairoExtendMode;
+			Cairo::Filter				cairoFilterMode;
+			double						fLineWidth;
+			gushort						ausBgColor[3];
+			std::string					strFontFamily;
+			double						fFontSize;
+			Cairo::FontWeight			cairoFontWeight;
+			Cairo::FontSlant			cairoFontSlant;
+			std::string					strSomeText;
+			std::string					strImageFileName;
+			std::string					strSvgFileName;
+			time_t						fileMTime;	// of the file the sample reads
+
+			bool operator== (const _SampleKey& other) const;
+		} SampleKey;
+
+		// the last output of a sample, rendered into a surface of the
+		// canvas' size, and replayed as long as its key stays the same
+		typedef struct _SampleRaster
+		{
+			SampleKey			key;
+			bool				bKeyValid;
+			cairo_surface_t*	pRaster;
+		} SampleRaster;
+
+		// like the SVG-cache, rasters are never shared with a copy. Only the
+		// sample on screen keeps its raster, each one is as big as the canvas
+		class SampleCache : public std::map<Sample, SampleRaster>
+		{
+			public:
+				SampleCache () {}
+				SampleCache (const SampleCache& other) {}
+				SampleCache& operator= (const SampleCache& other) { return *this; }
+				~SampleCache ();
+				void flush ();
+				void flush_others (Sample sample);
+		};
+
+		// a string laid out as glyphs for one scaled font (face, size and
+		// transformation), placed at the origin
+		typedef struct _GlyphRun
+		{
+			cairo_glyph_t*		pGlyphs;
+			int					iGlyphs;
+			double				fAdvanceX;
+			double				fAdvanceY;
+		} GlyphRun;
+
+		// faces keyed by family, slant and weight, and glyph-runs keyed by
+		// the scaled font (held by a reference) and the text
+		class FontCache : public std::map<std::string, cairo_font_face_t*>
+		{
+			public:
+				FontCache () {}
+				FontCache (const FontCache& other) {}
+				FontCache& operator= (const FontCache& other) { return *this; }
+				~FontCache ();
+		};
+
+		class GlyphRunCache : public std::map<std::pair<cairo_scaled_font_t*, std::string>, GlyphRun>
+		{
+			public:
+				GlyphRunCache () {}
+				GlyphRunCache (const GlyphRunCache& other) {}
+				GlyphRunCache& operator= (const GlyphRunCache& other) { return *this; }
+				~GlyphRunCache ();
+				void flush ();
+		};
+
+		void select_font (std::string strFamily,
+						  Cairo::FontSlant cairoFontSlant,
+						  Cairo::FontWeight cairoFontWeight);
+		GlyphRun* get_glyph_run (std::string strText);
+		void show_text_run (std::string strText);
+		void text_path_run (std::string strText);
+		void text_extents_run (std::string strText, Cairo::TextExtents& extents);
+		bool draw_sample (Sample sample);
+		bool sample_is_static (Sample sample);
+		void get_sample_key (Sample sample,
+							 int iWidth,
+							 int iHeight,
+							 SampleKey* pKey);
+		void blit_raster (cairo_surface_t* pRaster, int iWidth, int iHeight);
+		SvgDocument* get_svg (std::string strFileName);
+		void render_svg (std::string strFileName);
+		void drop_svg (std::string strFileName);
+		cairo_surface_t* get_image (double fUserSize);
+		const AnimationChannels& get_animation () const;
 		HandlePoint get_center ();
 		HandlePoint get_point1 ();
 		HandlePoint get_point2 ();
@@ -184,27 +339,9 @@ class CairoSamples
 		bool xxx_self_intersect ();
 
 	protected:
-		HandlePoint			m_center;
-		HandlePoint			m_point1;
-		HandlePoint			m_point2;
-		HandlePoint			m_point3;
-		HandlePoint			m_point4;
-		double				m_fRadius;
-		double				m_fAngle1;
-		double				m_fAngle2;
-		double				m_centerXStep;
-		double				m_centerYStep;
-		double				m_point1XStep;
-		double				m_point1YStep;
-		double				m_point2XStep;
-		double				m_point2YStep;
-		double				m_point3XStep;
-		double				m_point3YStep;
-		double				m_point4XStep;
-		double				m_point4YStep;
-		double				m_fRadiusStep;
-		double				m_fAngle1Step;
-		double				m_fAngle2Step;
+		AnimationChannels			m_animation;
+		const AnimationChannels*	m_pSharedAnimation;
+		int							m_iAnimationInstance;
 		Cairo::Context*		m_pCairoContext;
 		Cairo::LineCap		m_cairoCapStyle;
 		Cairo::LineJoin		m_cairoJoinStyle;
@@ -221,8 +358,16 @@ class CairoSamples
 		std::string			m_strSomeText;
 		std::string			m_strImageFileName;
 		std::string			m_strSvgFileName;
-		std::vector<Entry>	m_sampleList;
+		SampleList			m_sampleList;
 		unsigned long		m_ulMilliSeconds;
+		SvgCache			m_svgCache;
+		SampleCache			m_sampleCache;
+		FontCache			m_fontCache;
+		GlyphRunCache		m_glyphRunCache;
+		bool				m_bReplayCache;
+		unsigned long		m_ulAnimationStep;	// counts do_animation_step ()
+		bool				m_bWaitForImages;
+		bool				m_bImagePending;	// get_image () didn't wait
 };
 
 #endif /*_CAIROSAMPLES_H_*/
@@ -0,0 +1,357 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <sys/stat.h>
+
+#include "image-cache.h"
+
+ImageCache* ImageCache::get_default ()
+{
+	static ImageCache imageCache;
+
+	return &imageCache;
+}
+
+ImageCache::ImageCache ()
+{
+	m_bThreadRunning = false;
+	m_bQuit = false;
+	pthread_mutex_init (&m_mutex, NULL);
+	pthread_cond_init (&m_requested, NULL);
+	pthread_cond_init (&m_decoded, NULL);
+}
+
+ImageCache::~ImageCache ()
+{
+	pthread_mutex_lock (&m_mutex);
+	m_bQuit = true;
+	pthread_cond_signal (&m_requested);
+	pthread_mutex_unlock (&m_mutex);
+
+	if (m_bThreadRunning)
+		pthread_join (m_thread, NULL);
+
+	for (std::map<std::string, Image>::iterator iter = m_images.begin ();
+		 iter != m_images.end ();
+		 iter++)
+		drop (&iter->second);
+
+	pthread_cond_destroy (&m_decoded);
+	pthread_cond_destroy (&m_requested);
+	pthread_mutex_destroy (&m_mutex);
+}
+
+void ImageCache::drop (Image* pImage)
+{
+	for (std::vector<cairo_surface_t*>::iterator iter = pImage->levels.begin ();
+		 iter != pImage->levels.end ();
+		 iter++)
+		cairo_surface_destroy (*iter);
+
+	pImage->levels.clear ();
+}
+
+// makes sure strFileName is either decoded as it is on disk now or queued
+// for the worker, false if there's no such file
+bool ImageCache::queue (std::string strFileName)
+{
+	struct stat fileInfo;
+	std::map<std::string, Image>::iterator iter;
+
+	iter = m_images.find (strFileName);
+
+	if (stat (strFileName.c_str (), &fileInfo) != 0)
+	{
+		if (iter != m_images.end ())
+		{
+			drop (&iter->second);
+			m_images.erase (iter);
+		}
+
+		return false;
+	}
+
+	if (iter != m_images.end ())
+	{
+		if (iter->second.mTime == fileInfo.st_mtime)
+			return true;
+
+		// the worker notices the new time when it's done with a pending
+		// decode and starts over
+		iter->second.mTime = fileInfo.st_mtime;
+		if (!iter->second.bDecoded)
+			return true;
+
+		drop (&iter->second);
+		iter->second.bDecoded = false;
+	}
+	else
+	{
+		Image& image = m_images[strFileName];
+
+		image.mTime = fileInfo.st_mtime;
+		image.bDecoded = false;
+	}
+
+	m_pending.push_back (strFileName);
+
+	if (!m_bThreadRunning)
+		m_bThreadRunning = pthread_create (&m_thread,
+										   NULL,
+										   worker_main,
+										   this) == 0;
+
+	if (m_bThreadRunning)
+		pthread_cond_signal (&m_requested);
+	else
+	{
+		// no thread, decode right here
+		pthread_mutex_unlock (&m_mutex);
+		decode_pending ();
+		pthread_mutex_lock (&m_mutex);
+	}
+
+	return true;
+}
+
+void ImageCache::request (std::string strFileName)
+{
+	pthread_mutex_lock (&m_mutex);
+	queue (strFileName);
+	pthread_mutex_unlock (&m_mutex);
+}
+
+cairo_surface_t* ImageCache::get (std::string strFileName,
+								  double fDeviceWidth,
+								  double fDeviceHeight,
+								  bool* pbPending)
+{
+	std::map<std::string, Image>::iterator iter;
+	cairo_surface_t* pSurface = NULL;
+
+	if (pbPending)
+		*pbPending = false;
+
+	pthread_mutex_lock (&m_mutex);
+
+	if (queue (strFileName))
+	{
+		for (;;)
+		{
+			iter = m_images.find (strFileName);
+			if (iter == m_images.end () || iter->second.bDecoded)
+				break;
+
+			if (pbPending)
+			{
+				*pbPending = true;
+				iter = m_images.end ();
+				break;
+			}
+
+			pthread_cond_wait (&m_decoded, &m_mutex);
+		}
+
+		if (iter != m_images.end () && !iter->second.levels.empty ())
+		{
+			std::vector<cairo_surface_t*>& levels = iter->second.levels;
+			unsigned int uiLevel = 0;
+
+			if (fDeviceWidth > 0.0f && fDeviceHeight > 0.0f)
+				while (uiLevel + 1 < levels.size () &&
+					   cairo_image_surface_get_width (levels[uiLevel + 1]) >= fDeviceWidth &&
+					   cairo_image_surface_get_height (levels[uiLevel + 1]) >= fDeviceHeight)
+					uiLevel++;
+
+			pSurface = cairo_surface_reference (levels[uiLevel]);
+		}
+	}
+
+	pthread_mutex_unlock (&m_mutex);
+
+	return pSurface;
+}
+
+bool ImageCache::has_pending ()
+{
+	std::map<std::string, Image>::iterator iter;
+	bool bPending = false;
+
+	pthread_mutex_lock (&m_mutex);
+	for (iter = m_images.begin (); iter != m_images.end (); iter++)
+		if (!iter->second.bDecoded)
+			bPending = true;
+	pthread_mutex_unlock (&m_mutex);
+
+	return bPending;
+}
+
+void* ImageCache::worker_main (void* pData)
+{
+	ImageCache* pImageCache = (ImageCache*) pData;
+
+	pthread_mutex_lock (&pImageCache->m_mutex);
+	while (!pImageCache->m_bQuit)
+	{
+		if (pImageCache->m_pending.empty ())
+		{
+			pthread_cond_wait (&pImageCache->m_requested,
+							   &pImageCache->m_mutex);
+			continue;
+		}
+
+		pthread_mutex_unlock (&pImageCache->m_mutex);
+		pImageCache->decode_pending ();
+		pthread_mutex_lock (&pImageCache->m_mutex);
+	}
+	pthread_mutex_unlock (&pImageCache->m_mutex);
+
+	return NULL;
+}
+
+// decodes everything queued so far, called without m_mutex held
+void ImageCache::decode_pending ()
+{
+	pthread_mutex_lock (&m_mutex);
+	while (!m_pending.empty ())
+	{
+		std::string strFileName = m_pending.front ();
+		std::map<std::string, Image>::iterator iter;
+		Image image;
+
+		m_pending.pop_front ();
+		iter = m_images.find (strFileName);
+		if (iter == m_images.end () || iter->second.bDecoded)
+			continue;
+
+		pthread_mutex_unlock (&m_mutex);
+		decode (strFileName, &image);
+		pthread_mutex_lock (&m_mutex);
+
+		// the entry may have been dropped or the file changed meanwhile
+		iter = m_images.find (strFileName);
+		if (iter == m_images.end () || iter->second.bDecoded)
+			drop (&image);
+		else if (image.mTime && iter->second.mTime != image.mTime)
+		{
+			drop (&image);
+			m_pending.push_back (strFileName);
+		}
+		else
+		{
+			iter->second.levels = image.levels;
+			iter->second.bDecoded = true;
+		}
+
+		pthread_cond_broadcast (&m_decoded);
+	}
+	pthread_mutex_unlock (&m_mutex);
+}
+
+void ImageCache::decode (std::string strFileName, Image* pImage)
+{
+	struct stat fileInfo;
+	cairo_surface_t* pSurface;
+	cairo_format_t format;
+
+	pImage->mTime = 0;
+	pImage->bDecoded = true;
+	if (stat (strFileName.c_str (), &fileInfo) == 0)
+		pImage->mTime = fileInfo.st_mtime;
+
+	pSurface = cairo_image_surface_create_from_png (strFileName.c_str ());
+	if (cairo_surface_status (pSurface) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_surface_destroy (pSurface);
+		return;
+	}
+
+	pImage->levels.push_back (pSurface);
+
+	// the box-filter only knows about 4 bytes per pixel
+	format = cairo_image_surface_get_format (pSurface);
+	if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+		return;
+
+	while (cairo_image_surface_get_width (pSurface) > 1 ||
+		   cairo_image_surface_get_height (pSurface) > 1)
+	{
+		pSurface = half_size (pSurface);
+		pImage->levels.push_back (pSurface);
+	}
+}
+
+// averages 2x2 blocks of pixels, which is right for premultiplied colors and
+// for the unused byte of RGB24 alike. With an odd width or height the last
+// column or row goes into the last pixel, which then averages 3 of them, so
+// the image is neither cropped nor shifted
+cairo_surface_t* ImageCache::half_size (cairo_surface_t* pSource)
+{
+	int iWidth = cairo_image_surface_get_width (pSource);
+	int iHeight = cairo_image_surface_get_height (pSource);
+	int iStride = cairo_image_surface_get_stride (pSource);
+	int iHalfWidth = iWidth > 1 ? iWidth / 2 : 1;
+	int iHalfHeight = iHeight > 1 ? iHeight / 2 : 1;
+	cairo_surface_t* pHalf;
+	unsigned char* pcSource;
+	unsigned char* pcHalf;
+	int iHalfStride;
+	int iX;
+	int iY;
+
+	pHalf = cairo_image_surface_create (cairo_image_surface_get_format (pSource),
+										iHalfWidth,
+										iHalfHeight);
+	cairo_surface_flush (pSource);
+	cairo_surface_flush (pHalf);
+	pcSource = cairo_image_surface_get_data (pSource);
+	pcHalf = cairo_image_surface_get_data (pHalf);
+	iHalfStride = cairo_image_surface_get_stride (pHalf);
+
+	for (iY = 0; iY < iHalfHeight; iY++)
+	{
+		int iRow0 = 2 * iY;
+		int iRows = iY + 1 < iHalfHeight ? 2 : iHeight - iRow0;
+		unsigned char* pcOut = pcHalf + iY * iHalfStride;
+
+		for (iX = 0; iX < iHalfWidth; iX++)
+		{
+			int iColumn0 = 2 * iX;
+			int iColumns = iX + 1 < iHalfWidth ? 2 : iWidth - iColumn0;
+			int iCount = iRows * iColumns;
+			int aiSum[4] = {0, 0, 0, 0};
+
+			for (int iRow = iRow0; iRow < iRow0 + iRows; iRow++)
+			{
+				unsigned char* pcIn = pcSource + iRow * iStride + 4 * iColumn0;
+
+				for (int iColumn = 0; iColumn < iColumns; iColumn++)
+					for (int i = 0; i < 4; i++)
+						aiSum[i] += pcIn[4 * iColumn + i];
+			}
+
+			for (int i = 0; i < 4; i++)
+				pcOut[4 * iX + i] = (aiSum[i] + iCount / 2) / iCount;
+		}
+	}
+
+	cairo_surface_mark_dirty (pHalf);
+
+	return pHalf;
+}
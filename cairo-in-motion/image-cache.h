@@ -0,0 +1,87 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _IMAGECACHE_H_
+#define _IMAGECACHE_H_
+
+#include <cairo.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+// decoded PNGs, keyed by file-name and kept until the file changes on disk.
+// Decoding happens on a worker-thread, together with a chain of smaller
+// copies (each half the size of the one before, box-filtered, premultiplied
+// like the image itself) used when an image is drawn scaled down. Decoded
+// surfaces are never written to again, so unlike parsed SVGs they are shared
+// by every CairoSamples on every thread
+class ImageCache
+{
+	public:
+		static ImageCache* get_default ();
+
+		ImageCache ();
+		~ImageCache ();
+
+		// start decoding strFileName in the background, if needed
+		void request (std::string strFileName);
+
+		// a new reference to the smallest copy of strFileName that is still
+		// at least fDeviceWidth x fDeviceHeight pixels (0.0 for the original),
+		// waiting for the decoder if it isn't done yet. NULL if the file can't
+		// be loaded. Given pbPending it doesn't wait, but returns NULL with
+		// *pbPending set while the file is still being decoded
+		cairo_surface_t* get (std::string strFileName,
+							  double fDeviceWidth = 0.0f,
+							  double fDeviceHeight = 0.0f,
+							  bool* pbPending = NULL);
+
+		// whether anything is still queued or being decoded, so a caller
+		// that didn't wait knows to try again
+		bool has_pending ();
+
+	private:
+		typedef struct _Image
+		{
+			time_t							mTime;
+			bool							bDecoded;
+			std::vector<cairo_surface_t*>	levels;	// [0] is the original
+		} Image;
+
+		static void* worker_main (void* pData);
+		void decode_pending ();
+		static void decode (std::string strFileName, Image* pImage);
+		static cairo_surface_t* half_size (cairo_surface_t* pSource);
+		bool queue (std::string strFileName);	// called with m_mutex held
+		void drop (Image* pImage);
+
+		std::map<std::string, Image>	m_images;
+		std::deque<std::string>			m_pending;
+		pthread_mutex_t					m_mutex;
+		pthread_cond_t					m_requested;
+		pthread_cond_t					m_decoded;
+		pthread_t						m_thread;
+		bool							m_bThreadRunning;
+		bool							m_bQuit;
+};
+
+#endif /*_IMAGECACHE_H_*/
@@ -25,6 +25,8 @@
 
 #include "cairo-samples.h"
 #include "sample-list-store.h"
+#include "tiled-renderer.h"
+#include "image-cache.h"
 
 // widgets we get from the .glade file
 Gtk::Window* pMainWindow = NULL;
@@ -69,12 +71,15 @@ std::string m_strSomeText = "laber";
 // additional stuff we need/use for the cairo-drawing
 Gdk::Window* m_pGdkWindow = NULL;
 bool m_bAnimate = true;
-Cairo::Context* m_pCairoContext = NULL;
+Cairo::Context* m_pCairoContext = NULL;	// draws into m_pBackBuffer
+cairo_surface_t* m_pBackBuffer = NULL;	// same size as the drawing-area
 CairoSamples* m_pCairoSamples = NULL;
+TiledRenderer* m_pTiledRenderer = NULL;	// used with more than one CPU
 SampleListStore* m_pSampleListStore = NULL;
 int m_iSample = 17;
 int m_iAnimSmoothness = 25;
 sigc::connection timeoutHandlerConnection;
+sigc::connection imagePollConnection;
 Glib::Timer timer;
 
 void on_quit_menu_item ()
@@ -352,10 +357,9 @@ void on_bg_color_set ()
 
 bool on_timeout ()
 {
-	static unsigned long ulMicroSeconds;
-
-	timer.elapsed (ulMicroSeconds);
-	m_pCairoSamples->do_animation_step (ulMicroSeconds/1000);
+	// the animation goes by the time passed, not by the number of ticks
+	m_pCairoSamples->do_animation_step ((unsigned long) (timer.elapsed () *
+														 1000.0f));
 
 	// force a redraw of the cairo-context
 	pMainDrawingArea->queue_draw ();
@@ -363,6 +367,14 @@ bool on_timeout ()
 	return true;
 }
 
+// the samples don't wait for images being decoded, so look again shortly
+bool on_image_poll ()
+{
+	pMainDrawingArea->queue_draw ();
+
+	return false;
+}
+
 void on_anim_smoothness_changed ()
 {
 	m_iAnimSmoothness = (int) pAnimSmoothnessHScale->get_value ();
@@ -416,18 +428,83 @@ void on_sample_activated (const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn*
 	pMainDrawingArea->queue_draw ();
 }
 
-bool on_expose_event (GdkEventExpose* pEvent)
+// the samples draw into an offscreen image-surface, which is only
+// recreated (together with its context) when the drawing-area changes size
+void update_back_buffer (int iWidth, int iHeight)
 {
-	m_pCairoContext = new Cairo::Context (gdk_cairo_create (pMainDrawingArea->get_window()->gobj ()));
+	if (m_pBackBuffer &&
+		cairo_image_surface_get_width (m_pBackBuffer) == iWidth &&
+		cairo_image_surface_get_height (m_pBackBuffer) == iHeight)
+		return;
+
 	if (m_pCairoContext)
+		delete m_pCairoContext;
+	if (m_pBackBuffer)
+		cairo_surface_destroy (m_pBackBuffer);
+
+	m_pBackBuffer = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+												iWidth,
+												iHeight);
+	m_pCairoContext = new Cairo::Context (cairo_create (m_pBackBuffer), true);
+	m_pCairoSamples->set_context (m_pCairoContext);
+}
+
+bool on_expose_event (GdkEventExpose* pEvent)
+{
+	int iWidth = pMainDrawingArea->get_allocation().get_width ();
+	int iHeight = pMainDrawingArea->get_allocation().get_height ();
+	Gdk::Color bgColor = pMainDrawingArea->get_style()->get_bg (Gtk::STATE_NORMAL);
+	cairo_t* pBackContext;
+	cairo_t* pWindowContext;
+
+	if (iWidth < 1 || iHeight < 1)
+		return true;
+
+	update_back_buffer (iWidth, iHeight);
+	pBackContext = m_pCairoContext->cobj ();
+
+	if (m_pTiledRenderer->get_threads () > 1)
+		m_pTiledRenderer->render (*m_pCairoSamples,
+								  (CairoSamples::Sample) m_iSample,
+								  m_pBackBuffer,
+								  bgColor.get_red_p (),
+								  bgColor.get_green_p (),
+								  bgColor.get_blue_p ());
+	else
 	{
-		m_pCairoSamples->set_context (m_pCairoContext);
-		m_pCairoSamples->normalize_canvas ((double) pMainDrawingArea->get_allocation().get_width (),
-										   (double) pMainDrawingArea->get_allocation().get_height ());
+		// the context lives on, so every frame starts from a clean state
+		// and with what gtk+ would have cleared the window to
+		cairo_save (pBackContext);
+		cairo_new_path (pBackContext);
+		cairo_set_source_rgb (pBackContext,
+							  bgColor.get_red_p (),
+							  bgColor.get_green_p (),
+							  bgColor.get_blue_p ());
+		cairo_paint (pBackContext);
+
+		m_pCairoSamples->normalize_canvas ((double) iWidth, (double) iHeight);
 		m_pCairoSamples->do_sample ((CairoSamples::Sample) m_iSample);
-		delete m_pCairoContext;
+		cairo_restore (pBackContext);
+		cairo_new_path (pBackContext);
 	}
 
+	// present the finished frame with a single blit of the exposed area
+	pWindowContext = gdk_cairo_create (pMainDrawingArea->get_window()->gobj ());
+	cairo_rectangle (pWindowContext,
+					 pEvent->area.x,
+					 pEvent->area.y,
+					 pEvent->area.width,
+					 pEvent->area.height);
+	cairo_clip (pWindowContext);
+	cairo_set_operator (pWindowContext, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface (pWindowContext, m_pBackBuffer, 0.0f, 0.0f);
+	cairo_paint (pWindowContext);
+	cairo_destroy (pWindowContext);
+
+	if (ImageCache::get_default ()->has_pending () &&
+		!imagePollConnection.connected ())
+		imagePollConnection = Glib::signal_timeout().connect (sigc::ptr_fun (&on_image_poll), 50);
+
 	return true;
 }
 
@@ -706,10 +783,15 @@ int main (int argc, char** argv)
 				m_pCairoSamples->set_font_slant (m_fontSlant);
 				m_pCairoSamples->set_some_text (m_strSomeText);
 				m_pCairoSamples->set_image_file_name (m_strImageFileName);
+				m_pCairoSamples->set_wait_for_images (false);
 				m_pCairoSamples->set_svg_file_name (m_strSvgFileName);
 				m_pCairoSamples->add_samples_to_list_store (m_pSampleListStore);
 			}
+			m_pTiledRenderer = new TiledRenderer ();
 
+			// frames are composed offscreen and blitted in one go, gtk+'s
+			// own double-buffering would only add another copy
+			pMainDrawingArea->set_double_buffered (false);
 			pMainDrawingArea->signal_expose_event().connect (sigc::ptr_fun (on_expose_event));
 		}
 
@@ -800,6 +882,13 @@ int main (int argc, char** argv)
 		timer.start ();
 		app.run (*pMainWindow);
 		timer.stop ();
+
+		if (m_pCairoContext)
+			delete m_pCairoContext;
+		if (m_pBackBuffer)
+			cairo_surface_destroy (m_pBackBuffer);
+		if (m_pTiledRenderer)
+			delete m_pTiledRenderer;
 	}
 
 	return 0;
@@ -0,0 +1,172 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <unistd.h>
+
+#include "tiled-renderer.h"
+
+// every thread renders the complete sample once per tile, so there are only
+// a few tiles per thread, just enough to even out tiles of different cost
+#define TILES_PER_THREAD 2
+
+TiledRenderer::TiledRenderer (int iThreads)
+{
+	if (iThreads < 1)
+	{
+		long lCPUs = sysconf (_SC_NPROCESSORS_ONLN);
+
+		iThreads = lCPUs > 0 ? (int) lCPUs : 1;
+	}
+
+	m_workers.resize (iThreads);
+	for (int i = 0; i < iThreads; i++)
+	{
+		m_workers[i].pRenderer = this;
+		m_workers[i].iIndex = i;
+		m_workers[i].pCairoSamples = new CairoSamples ();
+		m_workers[i].bStarted = false;
+	}
+
+	pthread_mutex_init (&m_mutex, NULL);
+}
+
+TiledRenderer::~TiledRenderer ()
+{
+	for (std::vector<Worker>::iterator iter = m_workers.begin ();
+		 iter != m_workers.end ();
+		 iter++)
+		delete iter->pCairoSamples;
+
+	pthread_mutex_destroy (&m_mutex);
+}
+
+int TiledRenderer::get_threads () const
+{
+	return m_workers.size ();
+}
+
+void* TiledRenderer::worker_main (void* pData)
+{
+	Worker* pWorker = (Worker*) pData;
+
+	pWorker->pRenderer->render_tiles (pWorker->iIndex);
+
+	return NULL;
+}
+
+// a tile's surface points right into the target's pixels, so the tiles are
+// composited by the time they are drawn and no two threads touch the same
+// memory
+void TiledRenderer::render_tiles (int iWorker)
+{
+	CairoSamples* pCairoSamples = m_workers[iWorker].pCairoSamples;
+
+	for (;;)
+	{
+		int iTile;
+		int iY;
+		int iHeight;
+		cairo_surface_t* pSurface;
+		Cairo::Context* pCairoContext;
+		cairo_t* pContext;
+
+		pthread_mutex_lock (&m_mutex);
+		iTile = m_iNextTile++;
+		pthread_mutex_unlock (&m_mutex);
+
+		if (iTile >= m_iTiles)
+			break;
+
+		iY = iTile * m_iTargetHeight / m_iTiles;
+		iHeight = (iTile + 1) * m_iTargetHeight / m_iTiles - iY;
+		if (iHeight < 1)
+			continue;
+
+		pSurface = cairo_image_surface_create_for_data (m_pcTargetData +
+														iY * m_iTargetStride,
+														m_targetFormat,
+														m_iTargetWidth,
+														iHeight,
+														m_iTargetStride);
+		pCairoContext = new Cairo::Context (cairo_create (pSurface), true);
+		pContext = pCairoContext->cobj ();
+		pCairoSamples->set_context (pCairoContext);
+
+		cairo_set_source_rgb (pContext, m_fRed, m_fGreen, m_fBlue);
+		cairo_paint (pContext);
+		cairo_translate (pContext, 0.0f, -iY);
+		pCairoSamples->normalize_canvas ((double) m_iTargetWidth,
+										 (double) m_iTargetHeight);
+		pCairoSamples->do_sample (m_sample);
+
+		pCairoSamples->set_context (NULL);
+		delete pCairoContext;
+		cairo_surface_finish (pSurface);
+		cairo_surface_destroy (pSurface);
+	}
+}
+
+void TiledRenderer::render (const CairoSamples& samples,
+							CairoSamples::Sample sample,
+							cairo_surface_t* pTarget,
+							double fRed,
+							double fGreen,
+							double fBlue)
+{
+	int iThreads = m_workers.size ();
+	int i;
+
+	cairo_surface_flush (pTarget);
+
+	m_sample = sample;
+	m_pcTargetData = cairo_image_surface_get_data (pTarget);
+	m_targetFormat = cairo_image_surface_get_format (pTarget);
+	m_iTargetWidth = cairo_image_surface_get_width (pTarget);
+	m_iTargetHeight = cairo_image_surface_get_height (pTarget);
+	m_iTargetStride = cairo_image_surface_get_stride (pTarget);
+	m_fRed = fRed;
+	m_fGreen = fGreen;
+	m_fBlue = fBlue;
+	m_iTiles = iThreads * TILES_PER_THREAD;
+	if (m_iTiles > m_iTargetHeight)
+		m_iTiles = m_iTargetHeight;
+	m_iNextTile = 0;
+
+	// every worker draws with the current state of the samples, but keeps
+	// its own parsed SVGs, minus the ones that are no longer drawn
+	for (i = 0; i < iThreads; i++)
+	{
+		*m_workers[i].pCairoSamples = samples;
+		m_workers[i].pCairoSamples->drop_unused_svgs ();
+	}
+
+	// the calling thread is the first worker, and since tiles are handed out
+	// one by one it also picks up the share of a thread that didn't start
+	for (i = 1; i < iThreads; i++)
+		m_workers[i].bStarted = pthread_create (&m_workers[i].thread,
+												NULL,
+												worker_main,
+												&m_workers[i]) == 0;
+	render_tiles (0);
+	for (i = 1; i < iThreads; i++)
+		if (m_workers[i].bStarted)
+			pthread_join (m_workers[i].thread, NULL);
+
+	cairo_surface_mark_dirty (pTarget);
+}
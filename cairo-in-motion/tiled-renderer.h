@@ -0,0 +1,77 @@
+// "cairo in motion" is a testbed for animated vector-drawing
+// using cairo within a gtk+-environment
+//
+// Copyright (C) 2005 Mirco Mueller <macslow@bangang.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef _TILEDRENDERER_H_
+#define _TILEDRENDERER_H_
+
+#include <vector>
+#include <pthread.h>
+
+#include "cairo-samples.h"
+
+// renders a sample into an image-surface with several threads, each one
+// drawing the whole sample clipped to one horizontal tile of the target at a
+// time through its own copy of CairoSamples and its own surface and context
+class TiledRenderer
+{
+	public:
+		TiledRenderer (int iThreads = 0);	// 0 means one per CPU
+		~TiledRenderer ();
+
+		// clears pTarget (ARGB32 or RGB24) to the given color, then draws
+		// sample with the state (animation, line-width, ...) of samples
+		void render (const CairoSamples& samples,
+					 CairoSamples::Sample sample,
+					 cairo_surface_t* pTarget,
+					 double fRed,
+					 double fGreen,
+					 double fBlue);
+		int get_threads () const;
+
+	private:
+		static void* worker_main (void* pData);
+		void render_tiles (int iWorker);
+
+		typedef struct _Worker
+		{
+			TiledRenderer*	pRenderer;
+			int				iIndex;
+			CairoSamples*	pCairoSamples;
+			pthread_t		thread;
+			bool			bStarted;
+		} Worker;
+
+		std::vector<Worker>		m_workers;
+		pthread_mutex_t			m_mutex;
+
+		// the frame currently being rendered
+		CairoSamples::Sample	m_sample;
+		unsigned char*			m_pcTargetData;
+		cairo_format_t			m_targetFormat;
+		int						m_iTargetWidth;
+		int						m_iTargetHeight;
+		int						m_iTargetStride;
+		double					m_fRed;
+		double					m_fGreen;
+		double					m_fBlue;
+		int						m_iTiles;
+		int						m_iNextTile;
+};
+
+#endif /*_TILEDRENDERER_H_*/
@@ -5,6 +5,9 @@
  */
 
 #include <gtk/gtk.h>
+#include <gdk/gdkkeysyms.h>
+#include <pthread.h>
+#include <string.h>
 #include "puzzle.h"
 
 #define INITIAL_WIDTH  200
@@ -52,7 +55,9 @@ gint
 main (gint argc,
       gchar *argv[])
 {
-
+  /* the solver hands its result back from another thread */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
   gtk_init (&argc, &argv);
 
   puzzle_window = puzzle_window_new ();
@@ -61,6 +66,9 @@ main (gint argc,
   add_message ("Gtk Slide");
   add_message ("");
   add_message ("order the boxes");
+  add_message ("");
+  add_message ("h: hint  s: solve");
+  add_message ("r: reshuffle");
   g_timeout_add (100, update_messages ,puzzle);
 
   gtk_main ();
@@ -76,6 +84,11 @@ static void
 puzzle_solved (GtkWidget *widget,
                gpointer   data);
 
+static gboolean
+key_press (GtkWidget   *widget,
+           GdkEventKey *event,
+           gpointer     data);
+
 static GtkWidget *
 puzzle_window_new (void) {
   GtkWidget *self;
@@ -85,6 +98,8 @@ puzzle_window_new (void) {
   gtk_window_set_title (GTK_WINDOW (self), "Sliding Gtk Puzzle");
   g_signal_connect (G_OBJECT (self), "delete-event",
                     G_CALLBACK (gtk_main_quit), NULL);
+  g_signal_connect (G_OBJECT (self), "key-press-event",
+                    G_CALLBACK (key_press), NULL);
 
   vbox = gtk_vbox_new (FALSE, 0);
   gtk_container_set_border_width (GTK_CONTAINER (vbox), 0);
@@ -206,3 +221,125 @@ puzzle_solved (GtkWidget *widget,
   gtk_dialog_run (GTK_DIALOG (dialog));
   gtk_main_quit ();
 }
+
+/* a solve running on its own thread, on a copy of the board, the
+   result is handed back to the main loop through an idle handler */
+typedef struct _SolveJob SolveJob;
+
+struct _SolveJob {
+  guint8        cells[SLIDE_MAX_CELLS];
+  gint          rows;
+  gint          cols;
+  gboolean      hint;
+  gboolean      found;
+  SlideSolution solution;
+};
+
+static gboolean solving = FALSE;
+
+static gboolean
+solve_done (gpointer data)
+{
+  SolveJob *job = data;
+  guint8    cells[SLIDE_MAX_CELLS];
+  gint      rows, cols;
+  gchar    *message;
+
+  solving = FALSE;
+
+  if (!job->found)
+    {
+      add_message ("no solution found");
+      g_free (job);
+      return FALSE;
+    }
+
+  /* the tiles could be moved by hand while the solver was busy */
+  if (!puzzle_get_cells (PUZZLE (puzzle), cells, &rows, &cols) ||
+      rows != job->rows || cols != job->cols ||
+      memcmp (cells, job->cells, rows * cols))
+    {
+      add_message ("board changed");
+      slide_solution_free (&job->solution);
+      g_free (job);
+      return FALSE;
+    }
+
+  message = g_strdup_printf ("%s%i moves", job->solution.optimal ? "" : "~",
+                             job->solution.num_moves);
+  add_message (message);
+  g_free (message);
+  message = g_strdup_printf ("%" G_GUINT64_FORMAT " nodes %.2fs",
+                             job->solution.nodes, job->solution.seconds);
+  add_message (message);
+  g_free (message);
+  g_print ("solved in %i moves%s, %" G_GUINT64_FORMAT " nodes, %.3fs\n",
+           job->solution.num_moves, job->solution.optimal ? " (optimal)" : "",
+           job->solution.nodes, job->solution.seconds);
+
+  puzzle_play_moves (PUZZLE (puzzle), job->solution.moves,
+                     job->hint ? MIN (job->solution.num_moves, 1)
+                               : job->solution.num_moves);
+
+  slide_solution_free (&job->solution);
+  g_free (job);
+  return FALSE;
+}
+
+static void *
+solve_thread (void *data)
+{
+  SolveJob *job = data;
+
+  job->found = slide_solve (job->cells, job->rows, job->cols,
+                            &job->solution);
+  g_idle_add (solve_done, job);
+  return NULL;
+}
+
+/* 'h' plays the first move of a solution, 's' all of them, reporting
+   how long the solver took and how many nodes it searched. Building
+   pattern databases and searching can take seconds, so that happens
+   on a thread of its own. 'r' plays back a reshuffle
+*/
+static gboolean
+key_press (GtkWidget   *widget,
+           GdkEventKey *event,
+           gpointer     data)
+{
+  SolveJob  *job;
+  pthread_t  thread;
+
+  if (event->keyval != GDK_h && event->keyval != GDK_s &&
+      event->keyval != GDK_r)
+    return FALSE;
+
+  if (solving || puzzle_is_busy (PUZZLE (puzzle)))
+    return TRUE;
+
+  if (event->keyval == GDK_r)
+    {
+      puzzle_play_shuffle (PUZZLE (puzzle), shuffles);
+      return TRUE;
+    }
+
+  job = g_new0 (SolveJob, 1);
+  job->hint = event->keyval == GDK_h;
+  if (!puzzle_get_cells (PUZZLE (puzzle), job->cells, &job->rows, &job->cols))
+    {
+      add_message ("no solution found");
+      g_free (job);
+      return TRUE;
+    }
+
+  solving = TRUE;
+  add_message ("solving...");
+
+  /* without a thread, solve right here and live with the wait */
+  if (pthread_create (&thread, NULL, solve_thread, job) == 0)
+    pthread_detach (thread);
+  else
+    solve_thread (job);
+
+  return TRUE;
+}
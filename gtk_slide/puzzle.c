@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <gtk/gtk.h>
 #include "cairo_custom.h"
@@ -24,12 +25,32 @@ push_block (Puzzle *puzzle,
             gdouble ydelta);
 
 static void
-draw_board (Puzzle *puzzle, 
-            cairo_t *cr);
+draw_board (Puzzle    *puzzle, 
+            cairo_t   *cr,
+            GdkRegion *region);
+
+static void
+item_queue_redraw (Puzzle *puzzle,
+                   gint    item_no);
+
+static void
+tile_cache_flush (Puzzle *puzzle);
 
 static gint
 board_solved (Puzzle *puzzle);
 
+static void
+frame_request (Puzzle *puzzle);
+
+static void
+drag_flush (Puzzle *puzzle);
+
+static void
+snap_unaligned (Puzzle *puzzle);
+
+static void
+anim_cancel_all (Puzzle *puzzle);
+
 /** drawing_area derived widget **/
 
 static GObjectClass *parent_class = NULL;
@@ -41,6 +62,37 @@ typedef struct
   char  label[16];
 } PuzzleItem;
 
+/* the looks of a tile, each pre-rendered once per item and size */
+typedef enum
+{
+  TILE_ALIGNED,
+  TILE_MOVING,
+  TILE_GRABBED,
+  TILE_STATES
+} TileState;
+
+static void
+tile_rectangle (Puzzle       *puzzle,
+                PuzzleItem   *item,
+                GdkRectangle *rect);
+
+/* an item gliding from one position to another, eased over duration
+   seconds of the frame clock */
+typedef struct
+{
+  gboolean active;
+  gdouble  from_x;
+  gdouble  from_y;
+  gdouble  to_x;
+  gdouble  to_y;
+  gdouble  start;
+  gdouble  duration;
+} PuzzleAnim;
+
+#define FRAME_INTERVAL  16     /* ms between frames while animating */
+#define SNAP_SECONDS    0.15   /* easing a dropped block onto the grid */
+#define MOVE_SECONDS    0.12   /* each move played back */
+
 struct _Puzzle {
   GtkDrawingArea drawing_area;
 
@@ -52,6 +104,37 @@ struct _Puzzle {
 
   PuzzleItem *item;
 
+  /* occupancy grid: every item is filed under the cell holding its
+     top left corner, (floor (x), floor (y)), as a chain of item
+     numbers through cell_next. item_cell is the cell it is filed
+     under, or -1 */
+  gint *cell;
+  gint *cell_next;
+  gint *item_cell;
+
+  /* pre-rendered tiles, TILE_STATES per item, for the current ratio
+     and style, and the rectangle each item was last drawn to.
+     tile_cache_size is kept since rows and cols change before the
+     board is reinitialized */
+  cairo_surface_t **tile_cache;
+  gint              tile_cache_size;
+  GtkStyle         *tile_style;
+  GdkRectangle     *drawn;
+
+  /* animation, stepped once per frame by frame_tick () while there
+     is something to animate. Drag motion is accumulated in pending_x
+     and pending_y and applied once per frame too. playback holds
+     tiles, numbered as by the solver, still to be moved into the
+     hole one after another */
+  GTimer     *frame_clock;
+  guint       frame_source;
+  PuzzleAnim *anim;
+  gint        animating;
+  gdouble     pending_x;
+  gdouble     pending_y;
+  GArray     *playback;
+  guint       playback_pos;
+
   gint grabbed;
 
   gint rows;
@@ -143,9 +226,21 @@ finalize (GObject *object)
 
     if (puzzle->item)
       {
+        tile_cache_flush (puzzle);
         free (puzzle->item);
+        free (puzzle->cell);
+        free (puzzle->cell_next);
+        free (puzzle->item_cell);
+        free (puzzle->tile_cache);
+        free (puzzle->drawn);
+        free (puzzle->anim);
       }
 
+    if (puzzle->frame_source)
+      g_source_remove (puzzle->frame_source);
+    g_timer_destroy (puzzle->frame_clock);
+    g_array_free (puzzle->playback, TRUE);
+
     parent_class->finalize (object);
 }
 
@@ -169,7 +264,7 @@ puzzle_class_init (PuzzleClass * class)
                                                      "Number of rows",
                                                      "",
                                                      0,
-                                                     20,
+                                                     1000,
                                                      0,
                                                      G_PARAM_READWRITE));
 
@@ -179,7 +274,7 @@ puzzle_class_init (PuzzleClass * class)
                                                      "Number of cols",
                                                      "",
                                                      0,
-                                                     20,
+                                                     1000,
                                                      0,
                                                      G_PARAM_READWRITE));
 
@@ -211,6 +306,8 @@ puzzle_init (Puzzle * puzzle)
   puzzle->grabbed = -1;
   puzzle->ratio_x = 1;
   puzzle->ratio_y = 1;
+  puzzle->frame_clock = g_timer_new ();
+  puzzle->playback = g_array_new (FALSE, FALSE, sizeof (gint));
   board_init (GTK_WIDGET (puzzle));
   gtk_widget_show_all (GTK_WIDGET (puzzle));
 }
@@ -306,15 +403,22 @@ event_press (GtkWidget      *widget,
 {
   Puzzle *puzzle = PUZZLE (user_data);
 
+  /* leave the board alone while moves are being played back */
+  if (puzzle->playback_pos < puzzle->playback->len)
+    return FALSE;
+
   puzzle->cursorx = bev->x;
   puzzle->cursory = bev->y;
 
   switch (bev->button)
     {
       case 1:
+        /* blocks still snapping stay where they are */
+        anim_cancel_all (puzzle);
         puzzle->grabbed = query_pos (puzzle, bev->x, bev->y);
-        /* request a redraw, since we've changed the state of our widget */
-        gtk_widget_queue_draw (GTK_WIDGET (puzzle));
+        /* request a redraw of the tile we picked up */
+        if (puzzle->grabbed >= 0)
+          item_queue_redraw (puzzle, puzzle->grabbed);
         break;
     }
   return FALSE;
@@ -328,10 +432,16 @@ event_release (GtkWidget * widget,
     switch (bev->button)
       {
         case 1:
-          puzzle->grabbed = -1;
+          if (puzzle->grabbed >= 0)
+            {
+              gint item_no = puzzle->grabbed;
 
-          /* request a redraw, since we've changed the state of our widget */
-          gtk_widget_queue_draw (GTK_WIDGET (puzzle));
+              drag_flush (puzzle);
+              puzzle->grabbed = -1;
+              /* request a redraw of the tile we let go */
+              item_queue_redraw (puzzle, item_no);
+              snap_unaligned (puzzle);
+            }
           break;
       }
     return FALSE;
@@ -346,21 +456,11 @@ event_motion (GtkWidget      *widget,
 
     if (puzzle->grabbed>=0)
       {
-        double xdelta = (mev->x-puzzle->cursorx) / puzzle->ratio_x;
-        double ydelta = (mev->y-puzzle->cursory) / puzzle->ratio_y;
-
-        push_block (puzzle, puzzle->grabbed, xdelta, ydelta);
-
-        if (board_solved (puzzle))
-          {
-            g_signal_emit (G_OBJECT (puzzle),
-                           puzzle_signals
-                           [PUZZLE_SOLVED_SIGNAL], 0);
-          }
-
-
-        /* request a redraw, since we've changed the state of our widget */
-        gtk_widget_queue_draw (GTK_WIDGET (puzzle));
+        /* the block is pushed once per frame, however many motion
+           events arrive in between */
+        puzzle->pending_x += (mev->x-puzzle->cursorx) / puzzle->ratio_x;
+        puzzle->pending_y += (mev->y-puzzle->cursory) / puzzle->ratio_y;
+        frame_request (puzzle);
 
         puzzle->cursorx = mev->x;
         puzzle->cursory = mev->y;
@@ -378,11 +478,27 @@ paint (GtkDrawingArea *drawing_area,
   GtkWidget *widget = GTK_WIDGET (drawing_area);
   Puzzle *puzzle = PUZZLE (drawing_area);
   cairo_t *cr = gdk_cairo_create (widget->window);
+  gdouble ratio_x = (double) widget->allocation.width/puzzle->cols;
+  gdouble ratio_y = (double) widget->allocation.height/puzzle->rows;
+
+  /* the pre-rendered tiles only fit the size and style they were
+     made for, a resize redraws the whole widget anyway */
+  if (ratio_x != puzzle->ratio_x || ratio_y != puzzle->ratio_y ||
+      widget->style != puzzle->tile_style)
+    {
+      gint item_no;
 
-  puzzle->ratio_x = (double) widget->allocation.width/puzzle->cols;
-  puzzle->ratio_y = (double) widget->allocation.height/puzzle->rows;
+      puzzle->ratio_x = ratio_x;
+      puzzle->ratio_y = ratio_y;
+      tile_cache_flush (puzzle);
+      for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
+        tile_rectangle (puzzle, &(puzzle->item [item_no]), &(puzzle->drawn [item_no]));
+    }
 
-  draw_board (puzzle, cr);
+  gdk_cairo_region (cr, eev->region);
+  cairo_clip (cr);
+
+  draw_board (puzzle, cr, eev->region);
 
   if (cairo_status (cr))
     {
@@ -413,6 +529,43 @@ get_at (Puzzle *puzzle,
         gint    col,
         gint    row);
 
+/* the cell an item is filed under in the occupancy grid, clamped to
+   the board */
+static gint
+item_cell_no (Puzzle     *puzzle,
+              PuzzleItem *item)
+{
+  gint col = CLAMP ((gint) floor (item->x), 0, puzzle->cols-1);
+  gint row = CLAMP ((gint) floor (item->y), 0, puzzle->rows-1);
+
+  return row * puzzle->cols + col;
+}
+
+/* refile an item in the occupancy grid after it has moved, this is
+   a no-op unless it crossed into another cell */
+static void
+occupancy_update (Puzzle *puzzle,
+                  gint    item_no)
+{
+  gint  cell_no = item_cell_no (puzzle, &puzzle->item[item_no]);
+  gint *link;
+
+  if (puzzle->item_cell[item_no] == cell_no)
+    return;
+
+  if (puzzle->item_cell[item_no] >= 0)
+    {
+      link = &puzzle->cell[puzzle->item_cell[item_no]];
+      while (*link != item_no)
+        link = &puzzle->cell_next[*link];
+      *link = puzzle->cell_next[item_no];
+    }
+
+  puzzle->cell_next[item_no] = puzzle->cell[cell_no];
+  puzzle->cell[cell_no] = item_no;
+  puzzle->item_cell[item_no] = cell_no;
+}
+
 /* shuffle an initialized board (important, do not
    shuffle a board where the coordinates have changed
    since initialization, since the shuffeling presumes that
@@ -425,45 +578,59 @@ static
 void puzzle_shuffle (Puzzle *puzzle,
                      gint    shuffles)
 {
+  gint empty_x;
+  gint empty_y;
+
+  /* the board stays aligned while shuffling, so the hole simply
+     trades places with each block moved into it */
+  get_empty (puzzle, &empty_x, &empty_y);
+
   while (shuffles--)
     {
-      gint empty_x;
-      gint empty_y;
+      gint block_x = empty_x;
+      gint block_y = empty_y;
       gint block_no;
       gint direction = g_random_int_range (0, 5);
 
-      get_empty (puzzle, &empty_x, &empty_y);
-
       switch (direction)
         {
         case 0:
-          if ((block_no=get_at (puzzle, empty_x-1, empty_y))>=0)
+          if ((block_no=get_at (puzzle, --block_x, block_y))>=0)
             {
               push_block (puzzle, block_no, 0.5, 0  );
               push_block (puzzle, block_no, 0.5, 0  );
             }
           break;
         case 1:
-          if ((block_no=get_at (puzzle, empty_x+1, empty_y))>=0)
+          if ((block_no=get_at (puzzle, ++block_x, block_y))>=0)
             {
               push_block (puzzle, block_no, -0.5, 0  );
               push_block (puzzle, block_no, -0.5, 0  );
             }
           break;
         case 2:
-          if ((block_no=get_at (puzzle, empty_x, empty_y-1))>=0)
+          if ((block_no=get_at (puzzle, block_x, --block_y))>=0)
             {
               push_block (puzzle, block_no, 0, 0.5);
               push_block (puzzle, block_no, 0, 0.5);
             }
           break;
         case 3:
-          if ((block_no=get_at (puzzle, empty_x, empty_y+1))>=0)
+          if ((block_no=get_at (puzzle, block_x, ++block_y))>=0)
             {
               push_block (puzzle, block_no, 0, -0.5);
               push_block (puzzle, block_no, 0, -0.5);
             }
           break;
+        default:
+          block_no = -1;
+          break;
+        }
+
+      if (block_no >= 0 && get_at (puzzle, empty_x, empty_y) == block_no)
+        {
+          empty_x = block_x;
+          empty_y = block_y;
         }
     }
 }
@@ -478,14 +645,7 @@ get_empty (Puzzle *puzzle,
   for (*row=0; *row < puzzle->rows; (*row)++)
      for (*col=0; *col < puzzle->cols; (*col)++)
        {
-          gint item_no;
-          gint found=0;
-          for (item_no=0;item_no< puzzle->cols*puzzle->rows-1; item_no++)
-            {
-              if (puzzle->item[item_no].x == *col && puzzle->item[item_no].y == *row)
-                found++;
-            }
-          if (!found)
+          if (get_at (puzzle, *col, *row) < 0)
             return;
        }
 }
@@ -497,7 +657,13 @@ get_at (Puzzle *puzzle,
 {
   gint item_no;
 
-  for (item_no=0;item_no< puzzle->cols*puzzle->rows-1; item_no++)
+  if (col < 0 || col >= puzzle->cols ||
+      row < 0 || row >= puzzle->rows)
+    return -1;
+
+  for (item_no = puzzle->cell[row * puzzle->cols + col];
+       item_no >= 0;
+       item_no = puzzle->cell_next[item_no])
     {
       if (puzzle->item[item_no].x == col &&
           puzzle->item[item_no].y == row)
@@ -511,14 +677,34 @@ static void
 board_init (GtkWidget *widget)
 {
   Puzzle *puzzle = PUZZLE (widget);
-  gint row, col;
+  gint row, col, item_no;
 
   if (puzzle->item)
     {
+      tile_cache_flush (puzzle);
       free (puzzle->item);
+      free (puzzle->cell);
+      free (puzzle->cell_next);
+      free (puzzle->item_cell);
+      free (puzzle->tile_cache);
+      free (puzzle->drawn);
+      free (puzzle->anim);
     }
 
   puzzle->item = malloc (sizeof (PuzzleItem) * puzzle->rows * puzzle->cols);
+  puzzle->cell = malloc (sizeof (gint) * puzzle->rows * puzzle->cols);
+  puzzle->cell_next = malloc (sizeof (gint) * puzzle->rows * puzzle->cols);
+  puzzle->item_cell = malloc (sizeof (gint) * puzzle->rows * puzzle->cols);
+  puzzle->tile_cache_size = puzzle->rows * puzzle->cols * TILE_STATES;
+  puzzle->tile_cache = calloc (puzzle->tile_cache_size,
+                               sizeof (cairo_surface_t *));
+  puzzle->drawn = calloc (puzzle->rows * puzzle->cols, sizeof (GdkRectangle));
+  puzzle->anim = calloc (puzzle->rows * puzzle->cols, sizeof (PuzzleAnim));
+  puzzle->animating = 0;
+  puzzle->pending_x = 0;
+  puzzle->pending_y = 0;
+  g_array_set_size (puzzle->playback, 0);
+  puzzle->playback_pos = 0;
 
   for (row=0;row<puzzle->rows;row++)
     {
@@ -536,10 +722,18 @@ board_init (GtkWidget *widget)
               puzzle->item[row*puzzle->cols + col].y=row;
               sprintf (puzzle->item[row*puzzle->cols + col].label, "%i", row*puzzle->cols + col +1);
             }
+          puzzle->cell[row*puzzle->cols + col] = -1;
+          puzzle->item_cell[row*puzzle->cols + col] = -1;
         }
     }
 
+  for (item_no=0; item_no < puzzle->rows*puzzle->cols-1; item_no++)
+    occupancy_update (puzzle, item_no);
+
   puzzle_shuffle (puzzle, puzzle->shuffles);
+
+  for (item_no=0; item_no < puzzle->rows*puzzle->cols-1; item_no++)
+    tile_rectangle (puzzle, &(puzzle->item [item_no]), &(puzzle->drawn [item_no]));
   gtk_widget_queue_draw (GTK_WIDGET (puzzle));
 }
 
@@ -563,42 +757,53 @@ board_solved (Puzzle *puzzle)
 
 
 /* query which block is at the given mouse coordinates,
-   returns -1 if no block was found
+   returns -1 if no block was found. A block reaches at most 0.4
+   from its position, so only the blocks filed in the occupancy grid
+   under the (at most four) cells around the point are tested
 */
 static gint
 query_pos (Puzzle *puzzle,
            gint    x,
            gint    y)
 {
-  int item_no;
-  cairo_t *cr = gdk_cairo_create (GTK_WIDGET (puzzle)->window);
-
-  if (!cr)
-    {
-    }
-  cairo_save (cr);
-
+  gdouble px = x / puzzle->ratio_x - 0.5;
+  gdouble py = y / puzzle->ratio_y - 0.5;
+  gint col0 = MAX ((gint) floor (px - 0.4), 0);
+  gint col1 = MIN ((gint) floor (px + 0.4), puzzle->cols-1);
+  gint row0 = MAX ((gint) floor (py - 0.4), 0);
+  gint row1 = MIN ((gint) floor (py + 0.4), puzzle->rows-1);
+  gint col, row, item_no;
+  gint found = -1;
+  cairo_t *cr;
+
+  if (col0 > col1 || row0 > row1)
+    return -1;
+
+  cr = gdk_cairo_create (GTK_WIDGET (puzzle)->window);
   cairo_scale (cr, puzzle->ratio_x, puzzle->ratio_y);
   cairo_translate (cr, 0.5, 0.5);
 
-  for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-    {
-      PuzzleItem *item = & (puzzle->item [item_no]);
+  for (row=row0; row<=row1; row++)
+    for (col=col0; col<=col1; col++)
+      for (item_no = puzzle->cell[row * puzzle->cols + col];
+           item_no >= 0;
+           item_no = puzzle->cell_next[item_no])
+        {
+          PuzzleItem *item = & (puzzle->item [item_no]);
 
-      cairo_save (cr);
-      cairo_rectangle_round (cr, item->x-0.4, item->y-0.4, 0.8, 0.8, 0.4);
+          /* overlapping blocks resolve to the lowest number, as
+             they always did */
+          if (found >= 0 && item_no > found)
+            continue;
 
-      if (cairo_in_fill (cr, (x)/ puzzle->ratio_x -0.5, (y) / puzzle->ratio_y -0.5))
-        {
-              cairo_restore (cr);
-              cairo_restore (cr);
-          return item_no;
+          cairo_new_path (cr);
+          cairo_rectangle_round (cr, item->x-0.4, item->y-0.4, 0.8, 0.8, 0.4);
+          if (cairo_in_fill (cr, px, py))
+            found = item_no;
         }
-      cairo_restore (cr);
-    }
 
-  cairo_restore (cr);
-  return -1;
+  cairo_destroy (cr);
+  return found;
 }
 
 static gboolean
@@ -612,9 +817,10 @@ static void
 draw_item (cairo_t    *cr,
            GtkStyle   *style,
            PuzzleItem *item,
-           gboolean    grabbed)
+           TileState   state)
 {
-  gboolean aligned = item_is_aligned (item);
+  gboolean grabbed = state == TILE_GRABBED;
+  gboolean aligned = state == TILE_ALIGNED;
 
   cairo_rectangle_round (cr, item->x-0.36, item->y-0.36, 0.8, 0.8, 0.4);
   cairo_set_line_width (cr, 0.07);
@@ -690,32 +896,198 @@ draw_item (cairo_t    *cr,
 }
             
 
-/* draw the game board using the provided cairo context
+static TileState
+item_state (Puzzle *puzzle,
+            gint    item_no)
+{
+  if (item_no == puzzle->grabbed)
+    return TILE_GRABBED;
+  if (item_is_aligned (&(puzzle->item [item_no])))
+    return TILE_ALIGNED;
+  return TILE_MOVING;
+}
+
+/* the pixels covered by an item's tile: its cell, rounded to whole
+   pixels so tiles are copied without resampling, and a pixel of
+   border for the antialiasing
+*/
+static void
+tile_rectangle (Puzzle       *puzzle,
+                PuzzleItem   *item,
+                GdkRectangle *rect)
+{
+  rect->x = floor (item->x * puzzle->ratio_x + 0.5) - 1;
+  rect->y = floor (item->y * puzzle->ratio_y + 0.5) - 1;
+  rect->width = ceil (puzzle->ratio_x) + 2;
+  rect->height = ceil (puzzle->ratio_y) + 2;
+}
+
+/* request a redraw of where an item was last drawn and where it is
+   now, for use whenever it moves or changes state
 */
 static void
-draw_board (Puzzle  *puzzle,
-            cairo_t *cr)
+item_queue_redraw (Puzzle *puzzle,
+                   gint    item_no)
+{
+  GtkWidget    *widget = GTK_WIDGET (puzzle);
+  GdkRectangle *drawn = &(puzzle->drawn [item_no]);
+  GdkRectangle  rect;
+
+  tile_rectangle (puzzle, &(puzzle->item [item_no]), &rect);
+
+  if (drawn->width)
+    gtk_widget_queue_draw_area (widget, drawn->x, drawn->y,
+                                drawn->width, drawn->height);
+  if (!drawn->width || rect.x != drawn->x || rect.y != drawn->y ||
+      rect.width != drawn->width || rect.height != drawn->height)
+    gtk_widget_queue_draw_area (widget, rect.x, rect.y,
+                                rect.width, rect.height);
+  *drawn = rect;
+}
+
+static void
+tile_cache_flush (Puzzle *puzzle)
+{
+  gint i;
+
+  for (i=0;i<puzzle->tile_cache_size;i++)
+    {
+      if (puzzle->tile_cache [i])
+        cairo_surface_destroy (puzzle->tile_cache [i]);
+      puzzle->tile_cache [i] = NULL;
+    }
+  puzzle->tile_style = NULL;
+}
+
+/* the pre-rendered image of an item's tile in the given state,
+   rendered on first use into a surface like the one drawn to
+*/
+static cairo_surface_t *
+tile_get_surface (Puzzle    *puzzle,
+                  cairo_t   *target,
+                  gint       item_no,
+                  TileState  state)
+{
+  cairo_surface_t **surface = &(puzzle->tile_cache [item_no * TILE_STATES + state]);
+
+  if (!*surface)
+    {
+      PuzzleItem   tile = puzzle->item [item_no];
+      GdkRectangle rect;
+      cairo_t     *cr;
+
+      tile.x = 0;
+      tile.y = 0;
+      tile_rectangle (puzzle, &tile, &rect);
+      puzzle->tile_style = GTK_WIDGET (puzzle)->style;
+
+      *surface = cairo_surface_create_similar (cairo_get_target (target),
+                                               CAIRO_CONTENT_COLOR_ALPHA,
+                                               rect.width,
+                                               rect.height);
+      cr = cairo_create (*surface);
+        cairo_translate (cr, 1, 1);
+        cairo_select_font_face (cr, "sans", 0, 0);
+        cairo_scale (cr, puzzle->ratio_x, puzzle->ratio_y);
+        cairo_set_font_size (cr, 0.35);
+        cairo_translate (cr, 0.5, 0.5);
+        draw_item (cr, puzzle->tile_style, &tile, state);
+      cairo_destroy (cr);
+    }
+  return *surface;
+}
+
+/* draw the game board using the provided cairo context, copying the
+   pre-rendered tiles of the items overlapping the region to redraw
+*/
+static void
+draw_board (Puzzle    *puzzle,
+            cairo_t   *cr,
+            GdkRegion *region)
 {
   int item_no;
-  GtkStyle *style;
 
-  style = GTK_WIDGET (puzzle)->style;
+  for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
+    {
+      GdkRectangle *rect = &(puzzle->drawn [item_no]);
 
-  cairo_save (cr);
-    cairo_select_font_face (cr, "sans", 0, 0);
-    cairo_set_font_size (cr, 0.35);
-    cairo_scale (cr, puzzle->ratio_x, puzzle->ratio_y);
-    cairo_translate (cr, 0.5, 0.5);
+      if (gdk_region_rect_in (region, rect) == GDK_OVERLAP_RECTANGLE_OUT)
+        continue;
 
-    for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-      draw_item (cr, style, &(puzzle->item [item_no]), item_no == puzzle->grabbed);
+      cairo_set_source_surface (cr,
+                                tile_get_surface (puzzle, cr, item_no,
+                                                  item_state (puzzle, item_no)),
+                                rect->x, rect->y);
+      cairo_paint (cr);
+    }
+}
 
-  cairo_restore (cr);
+
+/* returns the lowest numbered item filed in the cells
+   [col0..col1] x [row0..row1] for which pushes () holds, or -1
+*/
+static int
+find_pushed (Puzzle     *puzzle,
+             PuzzleItem *block,
+             gint        col0,
+             gint        col1,
+             gint        row0,
+             gint        row1,
+             gdouble     delta,
+             gboolean  (*pushes) (PuzzleItem *block,
+                                  PuzzleItem *item,
+                                  gdouble     delta))
+{
+  gint col, row, item_no;
+  gint found = -1;
+
+  col0 = MAX (col0, 0);
+  row0 = MAX (row0, 0);
+  col1 = MIN (col1, puzzle->cols-1);
+  row1 = MIN (row1, puzzle->rows-1);
+
+  for (row=row0; row<=row1; row++)
+    for (col=col0; col<=col1; col++)
+      for (item_no = puzzle->cell[row * puzzle->cols + col];
+           item_no >= 0;
+           item_no = puzzle->cell_next[item_no])
+        {
+          if ((found < 0 || item_no < found) &&
+              pushes (block, &puzzle->item[item_no], delta))
+            found = item_no;
+        }
+  return found;
 }
 
+static gboolean
+pushes_x (PuzzleItem *block,
+          PuzzleItem *item,
+          gdouble     xdelta)
+{
+  if (!(item->y < block->y + 1 && item->y > block->y -1))
+    return FALSE;
+  if (xdelta<0)
+    return block->x > item->x && block->x + xdelta - 1 <= item->x;
+  else
+    return block->x < item->x && block->x + xdelta + 1 >= item->x;
+}
+
+static gboolean
+pushes_y (PuzzleItem *block,
+          PuzzleItem *item,
+          gdouble     ydelta)
+{
+  if (!(item->x < block->x + 1 && item->x > block->x -1))
+    return FALSE;
+  if (ydelta<0)
+    return block->y > item->y && block->y + ydelta - 1 <= item->y;
+  else
+    return block->y < item->y && block->y + ydelta + 1 >= item->y;
+}
 
 /* returns which block would be pushed by shifting 'block' the given amount
-   in x direction
+   in x direction, only looking at the few cells of the occupancy grid
+   the block could reach
 
    return: >=0 block id
             -1 none
@@ -726,7 +1098,6 @@ who_is_pushed_x (Puzzle *puzzle,
                  int     block_no,
                  double  xdelta)
 {
-  int item_no;
   PuzzleItem *block= & (puzzle->item [block_no]);
 
   if (xdelta<0)
@@ -734,36 +1105,26 @@ who_is_pushed_x (Puzzle *puzzle,
       if (block->x+xdelta<0)
         return -2;
 
-      for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-        {
-          PuzzleItem *item= & (puzzle->item [item_no]);
-          if (block->x > item->x && block->x + xdelta - 1 <= item->x
-              && item->y < block->y + 1 && item->y > block->y -1  )
-            {
-              return item_no;
-            }
-        }
+      return find_pushed (puzzle, block,
+                          floor (block->x + xdelta - 1), floor (block->x),
+                          floor (block->y - 1), floor (block->y + 1),
+                          xdelta, pushes_x);
     }
   else
     {
       if (block->x+xdelta>puzzle->cols-1)
         return -2;
 
-      for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-        {
-          PuzzleItem *item= & (puzzle->item [item_no]);
-          if (block->x < item->x && block->x + xdelta + 1 >= item->x
-              && item->y < block->y + 1 && item->y > block->y -1  )
-            {
-              return item_no;
-            }
-        }
+      return find_pushed (puzzle, block,
+                          floor (block->x), floor (block->x + xdelta + 1),
+                          floor (block->y - 1), floor (block->y + 1),
+                          xdelta, pushes_x);
     }
-  return -1;
 }
 
 /* returns which block would be pushed by shifting 'block' the given amount
-   in y direction
+   in y direction, only looking at the few cells of the occupancy grid
+   the block could reach
 
    return: >=0 block id
             -1 none
@@ -774,7 +1135,6 @@ who_is_pushed_y (Puzzle  *puzzle,
                  gint     block_no,
                  gdouble  ydelta)
 {
-  int item_no;
   PuzzleItem *block= & (puzzle->item [block_no]);
 
   if (ydelta<0)
@@ -782,41 +1142,29 @@ who_is_pushed_y (Puzzle  *puzzle,
       if (block->y+ydelta<0)
           return -2;
 
-      for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-        {
-          PuzzleItem *item= & (puzzle->item [item_no]);
-          if (block->y > item->y && block->y + ydelta - 1 <= item->y
-              && item->x < block->x + 1 && item->x > block->x -1  )
-            {
-
-              return item_no;
-            }
-        }
+      return find_pushed (puzzle, block,
+                          floor (block->x - 1), floor (block->x + 1),
+                          floor (block->y + ydelta - 1), floor (block->y),
+                          ydelta, pushes_y);
     }
   else
     {
       if (block->y+ydelta>puzzle->rows-1)
         return -2;
 
-      for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
-        {
-          PuzzleItem *item= & (puzzle->item [item_no]);
-          if (block->y < item->y && block->y + ydelta + 1 >= item->y
-              && item->x < block->x + 1 && item->x > block->x -1  )
-            {
-              return item_no;
-            }
-        }
+      return find_pushed (puzzle, block,
+                          floor (block->x - 1), floor (block->x + 1),
+                          floor (block->y), floor (block->y + ydelta + 1),
+                          ydelta, pushes_y);
     }
-  return -1;
 }
 
 /* attempt to push a block the given delta in x and y directions */
 static void
-push_block (Puzzle  *puzzle,
-            gint     block_no,
-            gdouble  xdelta,
-            gdouble  ydelta)
+push_block_real (Puzzle  *puzzle,
+                 gint     block_no,
+                 gdouble  xdelta,
+                 gdouble  ydelta)
 {
   PuzzleItem *block= & (puzzle->item [block_no]);
 
@@ -895,3 +1243,331 @@ push_block (Puzzle  *puzzle,
     }
   return;
 }
+
+static void
+push_block (Puzzle  *puzzle,
+            gint     block_no,
+            gdouble  xdelta,
+            gdouble  ydelta)
+{
+  PuzzleItem *block = &(puzzle->item [block_no]);
+  gdouble     x = block->x;
+  gdouble     y = block->y;
+
+  push_block_real (puzzle, block_no, xdelta, ydelta);
+  occupancy_update (puzzle, block_no);
+
+  if (block->x != x || block->y != y)
+    item_queue_redraw (puzzle, block_no);
+}
+
+/* the board packed for the solver, one byte per cell holding the
+   tile number, which is one more than the item number, or 0 for the
+   hole. Fails while blocks are between cells, dragged or animated
+*/
+gboolean
+puzzle_get_cells (Puzzle *puzzle,
+                  guint8 *cells,
+                  gint   *rows,
+                  gint   *cols)
+{
+  gint item_no;
+
+  if (puzzle_is_busy (puzzle) ||
+      puzzle->rows * puzzle->cols > SLIDE_MAX_CELLS)
+    return FALSE;
+
+  memset (cells, 0, puzzle->rows * puzzle->cols);
+  for (item_no=0; item_no < puzzle->rows*puzzle->cols-1; item_no++)
+    {
+      PuzzleItem *item = &(puzzle->item [item_no]);
+
+      if (!item_is_aligned (item))
+        return FALSE;
+      cells[(gint) floor (item->y) * puzzle->cols + (gint) floor (item->x)] = item_no + 1;
+    }
+
+  *rows = puzzle->rows;
+  *cols = puzzle->cols;
+  return TRUE;
+}
+
+/* frame clock driven animation */
+
+/* move an item straight to a position, bypassing the pushing rules */
+static void
+item_move_to (Puzzle  *puzzle,
+              gint     item_no,
+              gdouble  x,
+              gdouble  y)
+{
+  PuzzleItem *item = &(puzzle->item [item_no]);
+
+  if (item->x == x && item->y == y)
+    return;
+  item->x = x;
+  item->y = y;
+  occupancy_update (puzzle, item_no);
+  item_queue_redraw (puzzle, item_no);
+}
+
+static void
+anim_start (Puzzle  *puzzle,
+            gint     item_no,
+            gdouble  to_x,
+            gdouble  to_y,
+            gdouble  duration)
+{
+  PuzzleAnim *anim = &(puzzle->anim [item_no]);
+
+  if (!anim->active)
+    puzzle->animating++;
+  anim->active = TRUE;
+  anim->from_x = puzzle->item [item_no].x;
+  anim->from_y = puzzle->item [item_no].y;
+  anim->to_x = to_x;
+  anim->to_y = to_y;
+  anim->start = g_timer_elapsed (puzzle->frame_clock, NULL);
+  anim->duration = duration;
+  frame_request (puzzle);
+}
+
+static void
+anim_cancel_all (Puzzle *puzzle)
+{
+  gint item_no;
+
+  for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
+    puzzle->anim [item_no].active = FALSE;
+  puzzle->animating = 0;
+}
+
+/* ease every block left between cells onto the nearest one */
+static void
+snap_unaligned (Puzzle *puzzle)
+{
+  gint item_no;
+
+  for (item_no=0;item_no<puzzle->rows*puzzle->cols-1;item_no++)
+    {
+      PuzzleItem *item = &(puzzle->item [item_no]);
+
+      if (item_no != puzzle->grabbed && !item_is_aligned (item))
+        anim_start (puzzle, item_no, floor (item->x + 0.5),
+                    floor (item->y + 0.5), SNAP_SECONDS);
+    }
+}
+
+/* push the grabbed block by the motion gathered since the last frame */
+static void
+drag_flush (Puzzle *puzzle)
+{
+  if (puzzle->grabbed < 0 ||
+      (puzzle->pending_x == 0 && puzzle->pending_y == 0))
+    return;
+
+  push_block (puzzle, puzzle->grabbed, puzzle->pending_x, puzzle->pending_y);
+  puzzle->pending_x = 0;
+  puzzle->pending_y = 0;
+
+  if (board_solved (puzzle))
+    {
+      g_signal_emit (G_OBJECT (puzzle),
+                     puzzle_signals
+                     [PUZZLE_SOLVED_SIGNAL], 0);
+    }
+}
+
+/* start the next move of the playback, returns FALSE when there is
+   none, or it can not be made since the tile is not next to the hole
+*/
+static gboolean
+playback_next (Puzzle *puzzle)
+{
+  PuzzleItem *item;
+  gint        tile;
+  gint        empty_x, empty_y;
+
+  if (puzzle->playback_pos >= puzzle->playback->len)
+    return FALSE;
+
+  tile = g_array_index (puzzle->playback, gint, puzzle->playback_pos++);
+  item = &(puzzle->item [CLAMP (tile, 1, puzzle->rows * puzzle->cols - 1) - 1]);
+  get_empty (puzzle, &empty_x, &empty_y);
+
+  if (tile < 1 || tile >= puzzle->rows * puzzle->cols ||
+      fabs (empty_x - item->x) + fabs (empty_y - item->y) != 1.0)
+    {
+      g_array_set_size (puzzle->playback, 0);
+      puzzle->playback_pos = 0;
+      return FALSE;
+    }
+
+  anim_start (puzzle, tile-1, empty_x, empty_y, MOVE_SECONDS);
+  return TRUE;
+}
+
+/* one frame: apply the drag, advance every animation to the current
+   time of the frame clock, and start the next move of the playback
+   once the previous one has landed. The redraws requested on the way
+   are painted together after the frame
+*/
+static gboolean
+frame_tick (gpointer data)
+{
+  Puzzle  *puzzle = PUZZLE (data);
+  gdouble  now = g_timer_elapsed (puzzle->frame_clock, NULL);
+  gboolean landed = FALSE;
+  gint     item_no;
+
+  drag_flush (puzzle);
+
+  for (item_no=0;item_no<puzzle->rows*puzzle->cols-1 && puzzle->animating;item_no++)
+    {
+      PuzzleAnim *anim = &(puzzle->anim [item_no]);
+      gdouble     t, eased;
+
+      if (!anim->active)
+        continue;
+
+      t = (now - anim->start) / anim->duration;
+      if (t >= 1.0)
+        {
+          anim->active = FALSE;
+          puzzle->animating--;
+          landed = TRUE;
+          item_move_to (puzzle, item_no, anim->to_x, anim->to_y);
+          continue;
+        }
+
+      /* ease out, cubic */
+      eased = 1.0 - (1.0 - t) * (1.0 - t) * (1.0 - t);
+      item_move_to (puzzle, item_no,
+                    anim->from_x + (anim->to_x - anim->from_x) * eased,
+                    anim->from_y + (anim->to_y - anim->from_y) * eased);
+    }
+
+  if (!puzzle->animating && !playback_next (puzzle) && landed &&
+      puzzle->grabbed < 0 && board_solved (puzzle))
+    {
+      g_signal_emit (G_OBJECT (puzzle),
+                     puzzle_signals
+                     [PUZZLE_SOLVED_SIGNAL], 0);
+    }
+
+  if (puzzle->animating ||
+      puzzle->pending_x != 0 || puzzle->pending_y != 0)
+    return TRUE;
+
+  puzzle->frame_source = 0;
+  return FALSE;
+}
+
+static void
+frame_request (Puzzle *puzzle)
+{
+  if (!puzzle->frame_source)
+    puzzle->frame_source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                               FRAME_INTERVAL,
+                                               frame_tick, puzzle, NULL);
+}
+
+/* TRUE while blocks are being dragged, eased onto the grid or moves
+   are being played back */
+gboolean
+puzzle_is_busy (Puzzle *puzzle)
+{
+  return puzzle->grabbed >= 0 || puzzle->animating ||
+         puzzle->playback_pos < puzzle->playback->len;
+}
+
+/* animate a sequence of tiles, numbered as by the solver, each slid
+   into the hole in turn, after any moves already being played back
+*/
+void
+puzzle_play_moves (Puzzle     *puzzle,
+                   const gint *tiles,
+                   gint        num_tiles)
+{
+  g_array_append_vals (puzzle->playback, tiles, num_tiles);
+  if (!puzzle->animating)
+    playback_next (puzzle);
+}
+
+/* animate a random walk of the hole, the played back counterpart of
+   puzzle_shuffle ()
+*/
+void
+puzzle_play_shuffle (Puzzle *puzzle,
+                     gint    shuffles)
+{
+  gint  empty_x, empty_y;
+  gint  previous = -1;
+  gint *cells;
+  gint *tiles;
+  gint  count = 0;
+  gint  item_no;
+
+  if (puzzle_is_busy (puzzle))
+    return;
+
+  /* the walk is made on a copy of the board, holding the tile number
+     of each cell */
+  cells = g_new0 (gint, puzzle->rows * puzzle->cols);
+  for (item_no=0; item_no < puzzle->rows*puzzle->cols-1; item_no++)
+    {
+      PuzzleItem *item = &(puzzle->item [item_no]);
+
+      cells[(gint) floor (item->y + 0.5) * puzzle->cols +
+            (gint) floor (item->x + 0.5)] = item_no + 1;
+    }
+
+  tiles = g_new (gint, shuffles);
+  get_empty (puzzle, &empty_x, &empty_y);
+
+  while (count < shuffles)
+    {
+      static const gint dx[4] = { -1, 1, 0, 0 };
+      static const gint dy[4] = { 0, 0, -1, 1 };
+      gint neighbours[4];
+      gint num_neighbours = 0;
+      gint backtrack = -1;
+      gint block_x, block_y, block_no, i;
+
+      /* undoing the previous move is only allowed when it's the only
+         one, at the end of a 1xN or Nx1 board */
+      for (i=0; i<4; i++)
+        {
+          block_x = empty_x + dx[i];
+          block_y = empty_y + dy[i];
+          if (block_x < 0 || block_x >= puzzle->cols ||
+              block_y < 0 || block_y >= puzzle->rows)
+            continue;
+          block_no = block_y * puzzle->cols + block_x;
+          if (block_no == previous)
+            backtrack = block_no;
+          else
+            neighbours[num_neighbours++] = block_no;
+        }
+
+      if (num_neighbours)
+        block_no = neighbours[g_random_int_range (0, num_neighbours)];
+      else if (backtrack >= 0)
+        block_no = backtrack;
+      else
+        break;  /* a 1x1 board */
+      block_x = block_no % puzzle->cols;
+      block_y = block_no / puzzle->cols;
+
+      tiles[count++] = cells[block_no];
+      previous = empty_y * puzzle->cols + empty_x;
+      cells[previous] = cells[block_no];
+      cells[block_no] = 0;
+      empty_x = block_x;
+      empty_y = block_y;
+    }
+
+  puzzle_play_moves (puzzle, tiles, count);
+  g_free (tiles);
+  g_free (cells);
+}
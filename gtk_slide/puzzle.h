@@ -2,6 +2,7 @@
 #define PUZZLE_H
 
 #include <gtk/gtk.h>
+#include "solver.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,21 @@ extern "C" {
 
     GtkWidget *puzzle_new (void);
 
+    /* cells needs room for SLIDE_MAX_CELLS */
+    gboolean puzzle_get_cells (Puzzle *puzzle,
+                               guint8 *cells,
+                               gint   *rows,
+                               gint   *cols);
+
+    gboolean puzzle_is_busy (Puzzle *puzzle);
+
+    void puzzle_play_moves (Puzzle     *puzzle,
+                            const gint *tiles,
+                            gint        num_tiles);
+
+    void puzzle_play_shuffle (Puzzle *puzzle,
+                              gint    shuffles);
+
 #ifdef __cplusplus
 
 }
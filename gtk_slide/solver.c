@@ -0,0 +1,923 @@
+/* solver for sliding block puzzle boards
+ *
+ * IDA* over boards packed one byte per cell. The heuristic is the
+ * larger of manhattan distance plus linear conflicts and, for 4x4
+ * and 5x5 boards, the sum of additive pattern databases built the
+ * first time a board of that size is solved. The search tree is
+ * split a few moves below the root and the pieces are searched in
+ * parallel, one thread per processor, for each threshold.
+ *
+ * If an optimal search exceeds its node budget the heuristic is
+ * weighted and the search restarted, giving up optimality for
+ * solutions that can be found at all on larger boards.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "solver.h"
+
+#define SOLVER_MAX_THREADS   16
+#define SOLVER_NODE_BUDGET   100000000   /* nodes per attempt */
+
+/* boards up to OPTIMAL_MAX_CELLS are first searched unweighted, no
+   search is attempted on boards larger than SEARCH_MAX_CELLS */
+#define OPTIMAL_MAX_CELLS    25
+#define SEARCH_MAX_CELLS     64
+
+/* the search is split into at least this many pieces per thread,
+   expanding the root breadth first at most FRONTIER_MAX_DEPTH moves */
+#define FRONTIER_PER_THREAD  32
+#define FRONTIER_MAX_DEPTH   16
+
+/* heuristic weights in quarters, tried in order */
+#define WEIGHT_ONE           4
+static const gint weights[] = { 4, 6, 8, 12, 20, 32 };
+
+/* pattern databases */
+
+#define PDB_MAX_GROUPS       6
+#define PDB_MAX_GROUP_SIZE   5
+#define PDB_MAX_CELLS        25
+
+typedef struct
+{
+  gint          rows;
+  gint          cols;
+  gint          num_groups;
+  gint          group_size;
+  const guint8 *tiles;       /* num_groups * group_size tile numbers */
+
+  gint          tile_group[PDB_MAX_CELLS];
+  guint8       *table[PDB_MAX_GROUPS];
+} PatternDb;
+
+static const guint8 groups_4x4[] = {
+   1,  2,  3,  5,  6,
+   4,  7,  8, 11, 12,
+   9, 10, 13, 14, 15
+};
+
+static const guint8 groups_5x5[] = {
+   1,  2,  6,  7,
+   3,  4,  8,  9,
+   5, 10, 15, 20,
+  11, 12, 16, 17,
+  13, 14, 18, 19,
+  21, 22, 23, 24
+};
+
+static PatternDb pdb_4x4 = { 4, 4, 3, 5, groups_4x4, { 0 }, { NULL } };
+static PatternDb pdb_5x5 = { 5, 5, 6, 4, groups_5x5, { 0 }, { NULL } };
+
+/* rank of k distinct cells out of n, in [0, n!/(n-k)!) */
+static gint
+pattern_rank (const guint8 *cell,
+              gint          k,
+              gint          n)
+{
+  gint i, j;
+  gint rank = 0;
+
+  for (i = 0; i < k; i++)
+    {
+      gint digit = cell[i];
+
+      for (j = 0; j < i; j++)
+        if (cell[j] < cell[i])
+          digit--;
+      rank = rank * (n - i) + digit;
+    }
+  return rank;
+}
+
+static void
+pattern_unrank (gint    rank,
+                guint8 *cell,
+                gint    k,
+                gint    n)
+{
+  gint    digit[PDB_MAX_GROUP_SIZE];
+  guint32 used = 0;
+  gint    i;
+
+  for (i = k - 1; i > 0; i--)
+    {
+      digit[i] = rank % (n - i);
+      rank /= n - i;
+    }
+  digit[0] = rank;
+
+  for (i = 0; i < k; i++)
+    {
+      gint c;
+
+      for (c = 0; ; c++)
+        if (!(used & (1u << c)) && digit[i]-- == 0)
+          break;
+      cell[i] = c;
+      used |= 1u << c;
+    }
+}
+
+static gint
+pattern_entries (gint k,
+                 gint n)
+{
+  gint entries = 1;
+
+  while (k--)
+    entries *= n--;
+  return entries;
+}
+
+typedef struct
+{
+  guint32 *state;
+  gint     len;
+  gint     size;
+} StateQueue;
+
+static void
+state_queue_push (StateQueue *queue,
+                  guint32     state)
+{
+  if (queue->len == queue->size)
+    {
+      queue->size = queue->size ? queue->size * 2 : 4096;
+      queue->state = g_realloc (queue->state, queue->size * sizeof (guint32));
+    }
+  queue->state[queue->len++] = state;
+}
+
+typedef struct
+{
+  PatternDb *db;
+  gint       group;
+} PatternJob;
+
+/* breadth first search backwards from the goal over the positions of
+   one group's tiles and the hole, counting only moves of the group's
+   own tiles; the table keeps the cheapest over all hole positions.
+   Since no move is counted by two groups the tables add up to an
+   admissible heuristic */
+static void *
+pattern_db_build_group (void *data)
+{
+  PatternJob   *job = data;
+  PatternDb    *db = job->db;
+  gint          n = db->rows * db->cols;
+  gint          k = db->group_size;
+  const guint8 *tiles = db->tiles + job->group * k;
+  gint          entries = pattern_entries (k, n);
+  guint8       *dist = g_malloc (entries * n);
+  guint8       *table = g_malloc (entries);
+  StateQueue    level[2] = { { NULL, 0, 0 }, { NULL, 0, 0 } };
+  guint8        cell[PDB_MAX_GROUP_SIZE];
+  gint          depth, i;
+
+  memset (dist, 0xff, entries * n);
+
+  for (i = 0; i < k; i++)
+    cell[i] = tiles[i] - 1;
+  dist[pattern_rank (cell, k, n) * n + n - 1] = 0;
+  state_queue_push (&level[0], pattern_rank (cell, k, n) * n + n - 1);
+
+  for (depth = 0; level[depth & 1].len; depth++)
+    {
+      StateQueue *current = &level[depth & 1];
+      StateQueue *next = &level[(depth + 1) & 1];
+      gint        q;
+
+      /* moves of other tiles are free and stay on this level */
+      for (q = 0; q < current->len; q++)
+        {
+          guint32 state = current->state[q];
+          gint    rank = state / n;
+          gint    hole = state % n;
+          gint    occupant[PDB_MAX_CELLS];
+          gint    neighbour[4];
+          gint    num_neighbours = 0;
+          gint    j;
+
+          if (dist[state] != depth)
+            continue;
+
+          pattern_unrank (rank, cell, k, n);
+          for (j = 0; j < n; j++)
+            occupant[j] = -1;
+          for (j = 0; j < k; j++)
+            occupant[cell[j]] = j;
+
+          if (hole % db->cols > 0)
+            neighbour[num_neighbours++] = hole - 1;
+          if (hole % db->cols < db->cols - 1)
+            neighbour[num_neighbours++] = hole + 1;
+          if (hole >= db->cols)
+            neighbour[num_neighbours++] = hole - db->cols;
+          if (hole < n - db->cols)
+            neighbour[num_neighbours++] = hole + db->cols;
+
+          for (j = 0; j < num_neighbours; j++)
+            {
+              gint    c = neighbour[j];
+              guint32 to;
+
+              if (occupant[c] < 0)
+                {
+                  to = rank * n + c;
+                  if (dist[to] > depth)
+                    {
+                      dist[to] = depth;
+                      state_queue_push (current, to);
+                    }
+                }
+              else
+                {
+                  cell[occupant[c]] = hole;
+                  to = pattern_rank (cell, k, n) * n + c;
+                  cell[occupant[c]] = c;
+                  if (dist[to] > depth + 1)
+                    {
+                      dist[to] = depth + 1;
+                      state_queue_push (next, to);
+                    }
+                }
+            }
+        }
+      current->len = 0;
+    }
+
+  for (i = 0; i < entries; i++)
+    {
+      gint hole;
+
+      table[i] = 0xff;
+      for (hole = 0; hole < n; hole++)
+        if (dist[i * n + hole] < table[i])
+          table[i] = dist[i * n + hole];
+    }
+
+  g_free (level[0].state);
+  g_free (level[1].state);
+  g_free (dist);
+  db->table[job->group] = table;
+  return NULL;
+}
+
+/* build the tables of a pattern database the first time it is needed,
+   one thread per group, a group whose thread does not start is built
+   right here */
+static PatternDb *
+pattern_db_get (PatternDb *db)
+{
+  pthread_t  thread[PDB_MAX_GROUPS];
+  gboolean   started[PDB_MAX_GROUPS];
+  PatternJob job[PDB_MAX_GROUPS];
+  gint       group, i;
+
+  if (db->table[0])
+    return db;
+
+  for (group = 0; group < db->num_groups; group++)
+    for (i = 0; i < db->group_size; i++)
+      db->tile_group[db->tiles[group * db->group_size + i]] = group;
+
+  for (group = 0; group < db->num_groups; group++)
+    {
+      job[group].db = db;
+      job[group].group = group;
+      started[group] = pthread_create (&thread[group], NULL,
+                                       pattern_db_build_group,
+                                       &job[group]) == 0;
+    }
+  for (group = 0; group < db->num_groups; group++)
+    if (!started[group])
+      pattern_db_build_group (&job[group]);
+  for (group = 0; group < db->num_groups; group++)
+    if (started[group])
+      pthread_join (thread[group], NULL);
+
+  return db;
+}
+
+/* search */
+
+typedef struct
+{
+  gint       rows;
+  gint       cols;
+  gint       n;
+  gint       neighbour[SLIDE_MAX_CELLS][4];
+  gint       num_neighbours[SLIDE_MAX_CELLS];
+  PatternDb *pdb;
+  gint       weight;
+} Board;
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  volatile gint   stop;
+  gboolean        over_budget;
+  guint64         nodes;
+  gint            next_bound;
+
+  gint           *solution;
+  gint            solution_len;
+} Shared;
+
+typedef struct
+{
+  const Board *board;
+  Shared      *shared;
+
+  guint8       cells[SLIDE_MAX_CELLS];
+  guint8       pos[SLIDE_MAX_CELLS];      /* cell of each tile */
+  gint         hole;
+
+  gint         md;
+  gint         lc;
+  guint8       lc_row[SLIDE_MAX_CELLS];
+  guint8       lc_col[SLIDE_MAX_CELLS];
+  gint         pdb;
+  guint8       pdb_group[PDB_MAX_GROUPS];
+
+  gint        *path;
+  guint64      nodes;
+  guint64      nodes_reported;
+  gint         next_bound;
+} Search;
+
+static gint
+manhattan (const Board *board,
+           gint         cell,
+           gint         tile)
+{
+  return ABS (cell / board->cols - (tile - 1) / board->cols) +
+         ABS (cell % board->cols - (tile - 1) % board->cols);
+}
+
+/* twice the number of tiles that have to leave a row or column,
+   among those that belong in it, for the rest to be in order */
+static gint
+line_conflicts (const Search *s,
+                gint          first,
+                gint          stride,
+                gint          count,
+                gboolean      is_row)
+{
+  const Board *board = s->board;
+  gint goal[SLIDE_MAX_CELLS];
+  gint longest[SLIDE_MAX_CELLS];
+  gint len = 0, best = 0;
+  gint i, j;
+
+  for (i = 0; i < count; i++)
+    {
+      gint cell = first + i * stride;
+      gint tile = s->cells[cell];
+
+      if (!tile)
+        continue;
+      if (is_row && (tile - 1) / board->cols == cell / board->cols)
+        goal[len++] = (tile - 1) % board->cols;
+      else if (!is_row && (tile - 1) % board->cols == cell % board->cols)
+        goal[len++] = (tile - 1) / board->cols;
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      longest[i] = 1;
+      for (j = 0; j < i; j++)
+        if (goal[j] < goal[i] && longest[j] + 1 > longest[i])
+          longest[i] = longest[j] + 1;
+      best = MAX (best, longest[i]);
+    }
+  return 2 * (len - best);
+}
+
+static gint
+row_conflicts (const Search *s,
+               gint          row)
+{
+  return line_conflicts (s, row * s->board->cols, 1, s->board->cols, TRUE);
+}
+
+static gint
+col_conflicts (const Search *s,
+               gint          col)
+{
+  return line_conflicts (s, col, s->board->cols, s->board->rows, FALSE);
+}
+
+static gint
+pdb_group_value (const Search *s,
+                 gint          group)
+{
+  const PatternDb *db = s->board->pdb;
+  const guint8    *tiles = db->tiles + group * db->group_size;
+  guint8           cell[PDB_MAX_GROUP_SIZE];
+  gint             i;
+
+  for (i = 0; i < db->group_size; i++)
+    cell[i] = s->pos[tiles[i]];
+  return db->table[group][pattern_rank (cell, db->group_size, s->board->n)];
+}
+
+static void
+search_set (Search       *s,
+            const guint8 *cells)
+{
+  const Board *board = s->board;
+  gint         i;
+
+  memcpy (s->cells, cells, board->n);
+  s->md = 0;
+  for (i = 0; i < board->n; i++)
+    {
+      s->pos[cells[i]] = i;
+      if (cells[i])
+        s->md += manhattan (board, i, cells[i]);
+      else
+        s->hole = i;
+    }
+
+  s->lc = 0;
+  for (i = 0; i < board->rows; i++)
+    s->lc += s->lc_row[i] = row_conflicts (s, i);
+  for (i = 0; i < board->cols; i++)
+    s->lc += s->lc_col[i] = col_conflicts (s, i);
+
+  s->pdb = 0;
+  if (board->pdb)
+    for (i = 0; i < board->pdb->num_groups; i++)
+      s->pdb += s->pdb_group[i] = pdb_group_value (s, i);
+}
+
+/* slide the tile in cell 'from' into the hole at 'to', updating the
+   heuristic incrementally. A horizontal move leaves every row in the
+   same order and changes only the two columns involved, and the other
+   way around for a vertical move */
+static void
+search_move (Search *s,
+             gint    from,
+             gint    to)
+{
+  const Board *board = s->board;
+  gint         tile = s->cells[from];
+
+  s->md += manhattan (board, to, tile) - manhattan (board, from, tile);
+  s->cells[to] = tile;
+  s->cells[from] = 0;
+  s->pos[tile] = to;
+  s->pos[0] = from;
+  s->hole = from;
+
+  if (from / board->cols == to / board->cols)
+    {
+      gint a = from % board->cols;
+      gint b = to % board->cols;
+
+      s->lc -= s->lc_col[a] + s->lc_col[b];
+      s->lc_col[a] = col_conflicts (s, a);
+      s->lc_col[b] = col_conflicts (s, b);
+      s->lc += s->lc_col[a] + s->lc_col[b];
+    }
+  else
+    {
+      gint a = from / board->cols;
+      gint b = to / board->cols;
+
+      s->lc -= s->lc_row[a] + s->lc_row[b];
+      s->lc_row[a] = row_conflicts (s, a);
+      s->lc_row[b] = row_conflicts (s, b);
+      s->lc += s->lc_row[a] + s->lc_row[b];
+    }
+
+  if (board->pdb)
+    {
+      gint group = board->pdb->tile_group[tile];
+
+      s->pdb -= s->pdb_group[group];
+      s->pdb_group[group] = pdb_group_value (s, group);
+      s->pdb += s->pdb_group[group];
+    }
+}
+
+static gint
+search_heuristic (const Search *s)
+{
+  return MAX (s->md + s->lc, s->pdb);
+}
+
+/* fold this thread's node count into the shared total now and then,
+   stopping every thread once the budget is spent */
+static void
+search_report_nodes (Search *s)
+{
+  Shared *shared = s->shared;
+
+  pthread_mutex_lock (&shared->mutex);
+  shared->nodes += s->nodes - s->nodes_reported;
+  s->nodes_reported = s->nodes;
+  if (shared->nodes > SOLVER_NODE_BUDGET && !shared->stop)
+    {
+      shared->over_budget = TRUE;
+      shared->stop = TRUE;
+    }
+  pthread_mutex_unlock (&shared->mutex);
+}
+
+static gboolean
+search_dfs (Search *s,
+            gint    g,
+            gint    bound,
+            gint    previous_hole)
+{
+  const Board *board = s->board;
+  gint         h = search_heuristic (s);
+  gint         f = g + h * board->weight / WEIGHT_ONE;
+  gint         hole = s->hole;
+  gint         i;
+
+  if (f > bound)
+    {
+      if (f < s->next_bound)
+        s->next_bound = f;
+      return FALSE;
+    }
+  if (h == 0)
+    {
+      pthread_mutex_lock (&s->shared->mutex);
+      if (!s->shared->solution)
+        {
+          s->shared->solution = g_memdup (s->path, g * sizeof (gint));
+          s->shared->solution_len = g;
+        }
+      s->shared->stop = TRUE;
+      pthread_mutex_unlock (&s->shared->mutex);
+      return TRUE;
+    }
+
+  if ((++s->nodes & 0xffff) == 0)
+    search_report_nodes (s);
+  if (s->shared->stop)
+    return FALSE;
+
+  for (i = 0; i < board->num_neighbours[hole]; i++)
+    {
+      gint from = board->neighbour[hole][i];
+
+      if (from == previous_hole)
+        continue;
+
+      s->path[g] = s->cells[from];
+      search_move (s, from, hole);
+      if (search_dfs (s, g + 1, bound, hole))
+        return TRUE;
+      search_move (s, hole, from);
+    }
+  return FALSE;
+}
+
+/* the root is expanded breadth first into a frontier of boards a few
+   moves deep, which the threads take turns searching */
+
+typedef struct
+{
+  guint8 *cells;
+  gint    previous_hole;
+  gint    g;
+  gint   *path;
+} FrontierNode;
+
+typedef struct
+{
+  const Board  *board;
+  Shared       *shared;
+  FrontierNode *node;
+  gint          num_nodes;
+  gint          next_node;
+  gint          bound;
+} Iteration;
+
+static void *
+search_thread_main (void *data)
+{
+  Iteration *it = data;
+  Search    *s = g_new0 (Search, 1);
+
+  s->board = it->board;
+  s->shared = it->shared;
+  s->path = g_new (gint, MAX (it->bound, FRONTIER_MAX_DEPTH) + 1);
+  s->next_bound = G_MAXINT;
+
+  while (!it->shared->stop)
+    {
+      FrontierNode *node;
+      gint          node_no;
+
+      pthread_mutex_lock (&it->shared->mutex);
+      node_no = it->next_node++;
+      pthread_mutex_unlock (&it->shared->mutex);
+      if (node_no >= it->num_nodes)
+        break;
+
+      node = &it->node[node_no];
+      search_set (s, node->cells);
+      memcpy (s->path, node->path, node->g * sizeof (gint));
+      search_dfs (s, node->g, it->bound, node->previous_hole);
+    }
+
+  search_report_nodes (s);
+  pthread_mutex_lock (&it->shared->mutex);
+  if (s->next_bound < it->shared->next_bound)
+    it->shared->next_bound = s->next_bound;
+  pthread_mutex_unlock (&it->shared->mutex);
+
+  g_free (s->path);
+  g_free (s);
+  return NULL;
+}
+
+static void
+frontier_free (FrontierNode *node,
+               gint          num_nodes)
+{
+  gint i;
+
+  for (i = 0; i < num_nodes; i++)
+    {
+      g_free (node[i].cells);
+      g_free (node[i].path);
+    }
+  g_free (node);
+}
+
+/* expand the root until there are at least 'wanted' nodes, returns
+   the frontier, or NULL with *solution set if a solution turned up
+   on the way; being breadth first, that one is shortest */
+static FrontierNode *
+frontier_expand (const Board  *board,
+                 const guint8 *cells,
+                 gint          wanted,
+                 gint         *num_nodes,
+                 gint        **solution,
+                 gint         *solution_len)
+{
+  FrontierNode *layer = g_new0 (FrontierNode, 1);
+  gint          layer_len = 1;
+  gint          depth;
+
+  layer[0].cells = g_memdup (cells, board->n);
+  layer[0].previous_hole = -1;
+
+  for (depth = 0; ; depth++)
+    {
+      FrontierNode *next;
+      gint          next_len = 0;
+      gint          i, j;
+
+      for (i = 0; i < layer_len; i++)
+        {
+          for (j = 0; j < board->n; j++)
+            if (layer[i].cells[j] && layer[i].cells[j] != j + 1)
+              break;
+          if (j == board->n)
+            {
+              *solution = g_memdup (layer[i].path, depth * sizeof (gint));
+              *solution_len = depth;
+              frontier_free (layer, layer_len);
+              return NULL;
+            }
+        }
+
+      if (layer_len >= wanted || depth == FRONTIER_MAX_DEPTH)
+        break;
+
+      next = g_new0 (FrontierNode, layer_len * 4);
+      for (i = 0; i < layer_len; i++)
+        {
+          gint hole = (guint8 *) memchr (layer[i].cells, 0, board->n) - layer[i].cells;
+
+          for (j = 0; j < board->num_neighbours[hole]; j++)
+            {
+              gint          from = board->neighbour[hole][j];
+              FrontierNode *node = &next[next_len];
+
+              if (from == layer[i].previous_hole)
+                continue;
+
+              node->cells = g_memdup (layer[i].cells, board->n);
+              node->cells[hole] = node->cells[from];
+              node->cells[from] = 0;
+              node->previous_hole = hole;
+              node->g = depth + 1;
+              node->path = g_new (gint, depth + 1);
+              if (depth)
+                memcpy (node->path, layer[i].path, depth * sizeof (gint));
+              node->path[depth] = node->cells[hole];
+              next_len++;
+            }
+        }
+      frontier_free (layer, layer_len);
+      layer = next;
+      layer_len = next_len;
+    }
+
+  *num_nodes = layer_len;
+  return layer;
+}
+
+static gint
+solver_threads (void)
+{
+  glong count = sysconf (_SC_NPROCESSORS_ONLN);
+
+  return CLAMP (count, 1, SOLVER_MAX_THREADS);
+}
+
+gboolean
+slide_solvable (const guint8 *cells,
+                gint          rows,
+                gint          cols)
+{
+  gint     n = rows * cols;
+  gboolean seen[SLIDE_MAX_CELLS];
+  gint     inversions = 0;
+  gint     hole = 0;
+  gint     i, j;
+
+  if (rows < 1 || cols < 1 || n > SLIDE_MAX_CELLS)
+    return FALSE;
+
+  memset (seen, 0, sizeof (seen));
+  for (i = 0; i < n; i++)
+    {
+      if (cells[i] >= n || seen[cells[i]])
+        return FALSE;
+      seen[cells[i]] = TRUE;
+      if (!cells[i])
+        hole = i;
+      else
+        for (j = i + 1; j < n; j++)
+          if (cells[j] && cells[j] < cells[i])
+            inversions++;
+    }
+
+  /* a single row or column can not be reordered at all */
+  if (rows == 1 || cols == 1)
+    {
+      for (i = 0, j = 1; i < n; i++)
+        if (cells[i] && cells[i] != j++)
+          return FALSE;
+      return TRUE;
+    }
+
+  /* horizontal moves keep the inversion count, vertical ones change
+     it by cols-1 and move the hole one row */
+  if (cols % 2)
+    return inversions % 2 == 0;
+  return (inversions + hole / cols) % 2 == (rows - 1) % 2;
+}
+
+static gboolean
+solve_weighted (const Board  *board,
+                const guint8 *cells,
+                gint          threads,
+                SlideSolution *solution)
+{
+  Shared        shared;
+  Iteration     it;
+  FrontierNode *frontier;
+  gint          num_nodes = 0;
+  gint          bound;
+  gint          i;
+  gint          started;
+  pthread_t     thread[SOLVER_MAX_THREADS];
+
+  memset (&shared, 0, sizeof (shared));
+  pthread_mutex_init (&shared.mutex, NULL);
+
+  frontier = frontier_expand (board, cells, threads * FRONTIER_PER_THREAD,
+                              &num_nodes,
+                              &shared.solution, &shared.solution_len);
+
+  {
+    Search root;
+
+    memset (&root, 0, sizeof (root));
+    root.board = board;
+    search_set (&root, cells);
+    bound = search_heuristic (&root) * board->weight / WEIGHT_ONE;
+  }
+
+  while (frontier && !shared.stop)
+    {
+      it.board = board;
+      it.shared = &shared;
+      it.node = frontier;
+      it.num_nodes = num_nodes;
+      it.next_node = 0;
+      it.bound = bound;
+      shared.next_bound = G_MAXINT;
+
+      /* the frontier nodes are handed out one by one, so if some
+         threads do not start, the calling thread searches their share */
+      for (started = 0; started < threads; started++)
+        if (pthread_create (&thread[started], NULL,
+                            search_thread_main, &it) != 0)
+          break;
+      if (started < threads)
+        search_thread_main (&it);
+      for (i = 0; i < started; i++)
+        pthread_join (thread[i], NULL);
+
+      if (shared.next_bound == G_MAXINT)
+        break;
+      bound = shared.next_bound;
+    }
+
+  if (frontier)
+    frontier_free (frontier, num_nodes);
+  pthread_mutex_destroy (&shared.mutex);
+
+  solution->nodes += shared.nodes;
+  if (frontier && !shared.solution)
+    return FALSE;
+
+  solution->moves = shared.solution;
+  solution->num_moves = shared.solution_len;
+  solution->optimal = board->weight == WEIGHT_ONE;
+  return TRUE;
+}
+
+/* find a sequence of moves solving the board, optimal if possible,
+   returns FALSE if the board can not be solved, is too large to
+   search, or no solution was found within the node budgets */
+gboolean
+slide_solve (const guint8  *cells,
+             gint           rows,
+             gint           cols,
+             SlideSolution *solution)
+{
+  Board   *board;
+  GTimer  *timer = g_timer_new ();
+  gboolean found = FALSE;
+  gint     cell, i;
+
+  memset (solution, 0, sizeof (SlideSolution));
+
+  if (!slide_solvable (cells, rows, cols) || rows * cols > SEARCH_MAX_CELLS)
+    {
+      g_timer_destroy (timer);
+      return FALSE;
+    }
+
+  board = g_new0 (Board, 1);
+  board->rows = rows;
+  board->cols = cols;
+  board->n = rows * cols;
+  for (cell = 0; cell < board->n; cell++)
+    {
+      gint *neighbour = board->neighbour[cell];
+      gint *count = &board->num_neighbours[cell];
+
+      if (cell % cols > 0)
+        neighbour[(*count)++] = cell - 1;
+      if (cell % cols < cols - 1)
+        neighbour[(*count)++] = cell + 1;
+      if (cell >= cols)
+        neighbour[(*count)++] = cell - cols;
+      if (cell < board->n - cols)
+        neighbour[(*count)++] = cell + cols;
+    }
+
+  if (rows == 4 && cols == 4)
+    board->pdb = pattern_db_get (&pdb_4x4);
+  else if (rows == 5 && cols == 5)
+    board->pdb = pattern_db_get (&pdb_5x5);
+
+  for (i = board->n <= OPTIMAL_MAX_CELLS ? 0 : 2;
+       i < (gint) G_N_ELEMENTS (weights) && !found;
+       i++)
+    {
+      board->weight = weights[i];
+      found = solve_weighted (board, cells, solver_threads (), solution);
+    }
+
+  solution->seconds = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+  g_free (board);
+  return found;
+}
+
+void
+slide_solution_free (SlideSolution *solution)
+{
+  g_free (solution->moves);
+  solution->moves = NULL;
+  solution->num_moves = 0;
+}
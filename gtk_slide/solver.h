@@ -0,0 +1,40 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif                          /* __cplusplus */
+
+/* boards are passed to the solver packed one byte per cell, row by
+   row, holding the tile number (1 .. rows*cols-1) or 0 for the hole.
+   The goal has tile t in cell t-1 and the hole in the last cell */
+#define SLIDE_MAX_CELLS 256
+
+typedef struct _SlideSolution SlideSolution;
+
+struct _SlideSolution {
+  gint    *moves;       /* tile numbers, in the order they are slid into the hole */
+  gint     num_moves;
+  gboolean optimal;     /* FALSE if the search had to be weighted to finish */
+  guint64  nodes;       /* nodes expanded, over all threads */
+  gdouble  seconds;     /* wall clock time, including building pattern databases */
+};
+
+gboolean slide_solvable (const guint8 *cells,
+                         gint          rows,
+                         gint          cols);
+
+gboolean slide_solve (const guint8  *cells,
+                      gint           rows,
+                      gint           cols,
+                      SlideSolution *solution);
+
+void slide_solution_free (SlideSolution *solution);
+
+#ifdef __cplusplus
+
+}
+#endif                          /* __cplusplus */
+#endif                          /* SOLVER_H */
@@ -5,6 +5,7 @@
 #include <cairo-xlib.h>
 #include <gdk/gdkx.h>
 #include <math.h>
+#include <stdio.h>
 
 typedef struct _xy_pair Point;
 typedef struct _xy_pair Vector;
@@ -16,12 +17,44 @@ typedef struct _Model Model;
 typedef struct _Object Object;
 typedef struct _Attractor Attractor;
 typedef struct _Spring Spring;
+typedef struct _SpatialIndex SpatialIndex;
+
+typedef enum {
+  INTEGRATOR_EULER,
+  INTEGRATOR_VERLET,
+  INTEGRATOR_IMPLICIT
+} Integrator;
+
+static const char *integrator_names[] = { "Euler", "Verlet", "Implicit" };
 
-#define MODEL_MAX_SPRINGS 50
 #define MASS_INFINITE -1.0
 
 #define DEFAULT_SPRING_K 15.0
 #define DEFAULT_FRICTION  4.2
+#define DEFAULT_TIME_STEP 0.01
+#define DEFAULT_PATCHES   1
+
+/* The model originally advanced one unit of time per 100 ms tick.
+ * The physics clock keeps that pace, stepping at
+ * MODEL_TIME_PER_SECOND / dt Hz, which is 1 kHz for the default time
+ * step. Frames are drawn at about 60 Hz, each interpolating between
+ * the last two physics states. */
+#define MODEL_TIME_PER_SECOND 10.0
+#define FRAME_INTERVAL 16
+/* Beyond this the simulation slows down rather than falling ever
+ * further behind. */
+#define MAX_STEPS_PER_FRAME 200
+
+/* Iso-lines drawn across each patch, in each direction. */
+#define PATCH_GRID_DIVISIONS 5
+#define BEZIER_MAX_DIVISIONS 256
+
+/* Spatial index cells are about one spring rest length across. */
+#define INDEX_CELL_SIZE 50.0
+
+/* Limits for the conjugate-gradient solve of the implicit integrator. */
+#define CG_MAX_ITERATIONS 50
+#define CG_TOLERANCE 1e-10
 
 #define WALL_X 800
 #define WALL_Y 600
@@ -46,23 +79,62 @@ struct _Object {
   Point position;
   Vector velocity;
 
+  /* Position at the previous step, used by the Verlet integrator. */
+  Point previous_position;
+
+  /* Position at the start of the latest step, for drawing between
+   * physics steps. */
+  Point last_position;
+
   double mass;
   double theta;
 
   int immobile;
 };
 
+/* A uniform grid over the object positions. The plane is unbounded,
+ * so cells are hashed into buckets, each a doubly linked list of
+ * object indices threaded through next/prev. Objects remember the
+ * cell they were filed under so they only move between lists when
+ * they cross a cell boundary. */
+struct _SpatialIndex {
+  double cell_size;
+  int bucket_mask;	/* number of buckets - 1 */
+  int *buckets;		/* first object in each bucket, or -1 */
+  int *next;
+  int *prev;
+  int *cell_x;
+  int *cell_y;
+};
+
 struct _Model {
   int num_objects;
   Object *objects;
 
+  /* The objects form a grid_width x grid_height mesh of bicubic
+   * Bezier patches sharing their edges, so each dimension is 3n+1. */
+  int grid_width;
+  int grid_height;
+
   int num_springs;
-  Spring springs[MODEL_MAX_SPRINGS];
+  int max_springs;
+  Spring *springs;
+
+  SpatialIndex index;
 
   Object *anchor_object;
 
   double friction;	/* Friction constant */
   double k;		/* Spring constant */
+
+  Integrator integrator;
+  double dt;		/* Time step */
+
+  /* Fraction of a step to interpolate by when drawing, 0..1 */
+  double render_alpha;
+
+  /* Scratch vectors for the implicit solve, 4 * num_objects long. */
+  Vector *solver_work;
 };
 
 static void
@@ -76,6 +148,9 @@ object_init (Object *object,
   object->velocity.x = velocity_x;
   object->velocity.y = velocity_y;
 
+  object->previous_position = object->position;
+  object->last_position = object->position;
+
   object->mass = mass;
 
   object->force.x = 0;
@@ -102,7 +177,7 @@ model_add_spring (Model *model,
 {
   Spring *spring;
 
-  g_assert (model->num_springs < MODEL_MAX_SPRINGS);
+  g_assert (model->num_springs < model->max_springs);
 
   spring = &model->springs[model->num_springs];
   model->num_springs++;
@@ -110,6 +185,130 @@ model_add_spring (Model *model,
   spring_init (spring, object_a, object_b, offset_x, offset_y);
 }
 
+static int
+spatial_index_cell (SpatialIndex *index, double coordinate)
+{
+  return floor (coordinate / index->cell_size);
+}
+
+static int
+spatial_index_bucket (SpatialIndex *index, int cell_x, int cell_y)
+{
+  return ((unsigned) cell_x * 73856093u ^ (unsigned) cell_y * 19349663u)
+    & index->bucket_mask;
+}
+
+static void
+spatial_index_link (SpatialIndex *index, int i, int cell_x, int cell_y)
+{
+  int bucket = spatial_index_bucket (index, cell_x, cell_y);
+
+  index->cell_x[i] = cell_x;
+  index->cell_y[i] = cell_y;
+  index->prev[i] = -1;
+  index->next[i] = index->buckets[bucket];
+  if (index->next[i] >= 0)
+    index->prev[index->next[i]] = i;
+  index->buckets[bucket] = i;
+}
+
+static void
+spatial_index_unlink (SpatialIndex *index, int i)
+{
+  if (index->prev[i] >= 0)
+    index->next[index->prev[i]] = index->next[i];
+  else
+    index->buckets[spatial_index_bucket (index, index->cell_x[i],
+					 index->cell_y[i])] = index->next[i];
+
+  if (index->next[i] >= 0)
+    index->prev[index->next[i]] = index->prev[i];
+}
+
+/* Refile object i if it has left its cell. O(1). */
+static void
+spatial_index_update (SpatialIndex *index, int i, Point *position)
+{
+  int cell_x = spatial_index_cell (index, position->x);
+  int cell_y = spatial_index_cell (index, position->y);
+
+  if (cell_x == index->cell_x[i] && cell_y == index->cell_y[i])
+    return;
+
+  spatial_index_unlink (index, i);
+  spatial_index_link (index, i, cell_x, cell_y);
+}
+
+static void
+spatial_index_init (SpatialIndex *index, Object *objects, int num_objects)
+{
+  int i, num_buckets;
+
+  num_buckets = 1;
+  while (num_buckets < 2 * num_objects)
+    num_buckets *= 2;
+
+  index->cell_size = INDEX_CELL_SIZE;
+  index->bucket_mask = num_buckets - 1;
+  index->buckets = g_new (int, num_buckets);
+  index->next = g_new (int, num_objects);
+  index->prev = g_new (int, num_objects);
+  index->cell_x = g_new (int, num_objects);
+  index->cell_y = g_new (int, num_objects);
+
+  for (i = 0; i < num_buckets; i++)
+    index->buckets[i] = -1;
+
+  for (i = 0; i < num_objects; i++)
+    spatial_index_link (index, i,
+			spatial_index_cell (index, objects[i].position.x),
+			spatial_index_cell (index, objects[i].position.y));
+}
+
+typedef void (*ObjectFunc) (Object *object, double distance, void *closure);
+
+/* Call func for every object within radius of (x, y). Returns the
+ * number of cells visited. */
+static int
+spatial_index_foreach_in_radius (SpatialIndex *index, Object *objects,
+				 double x, double y, double radius,
+				 ObjectFunc func, void *closure)
+{
+  int x0, y0, x1, y1, cx, cy, i;
+  double dx, dy, distance;
+
+  x0 = spatial_index_cell (index, x - radius);
+  y0 = spatial_index_cell (index, y - radius);
+  x1 = spatial_index_cell (index, x + radius);
+  y1 = spatial_index_cell (index, y + radius);
+
+  for (cy = y0; cy <= y1; cy++)
+    for (cx = x0; cx <= x1; cx++)
+      for (i = index->buckets[spatial_index_bucket (index, cx, cy)];
+	   i >= 0; i = index->next[i]) {
+	/* Other cells may hash into the same bucket */
+	if (index->cell_x[i] != cx || index->cell_y[i] != cy)
+	  continue;
+
+	dx = objects[i].position.x - x;
+	dy = objects[i].position.y - y;
+	distance = sqrt (dx * dx + dy * dy);
+	if (distance <= radius)
+	  func (&objects[i], distance, closure);
+      }
+
+  return (x1 - x0 + 1) * (y1 - y0 + 1);
+}
+
+static void
+model_update_index (Model *model)
+{
+  int i;
+
+  for (i = 0; i < model->num_objects; i++)
+    spatial_index_update (&model->index, i, &model->objects[i].position);
+}
+
 static void
 model_init_grid (Model *model, int width, int height)
 {
@@ -118,8 +317,13 @@ model_init_grid (Model *model, int width, int height)
 
   model->objects = g_new (Object, width * height);
   model->num_objects = width * height;
+  model->solver_work = g_new (Vector, 4 * width * height);
+  model->grid_width = width;
+  model->grid_height = height;
 
   model->num_springs = 0;
+  model->max_springs = (width - 1) * height + width * (height - 1);
+  model->springs = g_new (Spring, model->max_springs);
 
   i = 0;
   for (y = 0; y < height; y++)
@@ -182,17 +386,22 @@ model_init_grid (Model *model, int width, int height)
 
       i++;
     }
+
+  spatial_index_init (&model->index, model->objects, model->num_objects);
 }
 
 static void
-model_init (Model *model)
+model_init (Model *model, int width, int height)
 {
   model->anchor_object = NULL;
 
-  model->k        = DEFAULT_SPRING_K;
-  model->friction = DEFAULT_FRICTION;
+  model->k          = DEFAULT_SPRING_K;
+  model->friction   = DEFAULT_FRICTION;
+  model->integrator = INTEGRATOR_EULER;
+  model->dt         = DEFAULT_TIME_STEP;
+  model->render_alpha = 1.0;
 
-  model_init_grid (model, 4, 4);
+  model_init_grid (model, width, height);
 }
 
 static void
@@ -249,12 +458,28 @@ spring_exert_forces (Spring *spring, double k)
   object_apply_force (spring->b, k * db.x, k * db.y);
 }
 
+static void
+object_collide_walls (Object *object)
+{
+  if (object->position.x > WALL_X) {
+    object->position.x = WALL_X - (object->position.x - WALL_X) * 0.7;
+    object->velocity.x = -object->velocity.x * 0.3;
+  }
+
+  if (object->position.y > WALL_Y) {
+    object->position.y = WALL_Y - (object->position.y - WALL_Y) * 0.7;
+    object->velocity.y = -object->velocity.y * 0.3;
+  }
+}
+
+/* Semi-implicit (symplectic) Euler. With dt == 1 this is exactly the
+ * original sproing integrator. */
 static void
 model_step_object (Model *model, Object *object)
 {
   Vector acceleration;
 
-  object->theta += 0.05;
+  object->theta += 0.05 * model->dt;
 
   /* Slow down due to friction. */
   object->force.x -= model->friction * object->velocity.x;
@@ -267,37 +492,326 @@ model_step_object (Model *model, Object *object)
     object->velocity.x = 0;
     object->velocity.y = 0;
   } else {
-    object->velocity.x += acceleration.x;
-    object->velocity.y += acceleration.y;
+    object->velocity.x += acceleration.x * model->dt;
+    object->velocity.y += acceleration.y * model->dt;
 
-    object->position.x += object->velocity.x;
-    object->position.y += object->velocity.y;
+    object->position.x += object->velocity.x * model->dt;
+    object->position.y += object->velocity.y * model->dt;
 
-    if (object->position.x > WALL_X) {
-      object->position.x = WALL_X - (object->position.x - WALL_X) * 0.7;
-      object->velocity.x = -object->velocity.x * 0.3;
-    }
+    object_collide_walls (object);
+  }
 
-    if (object->position.y > WALL_Y) {
-      object->position.y = WALL_Y - (object->position.y - WALL_Y) * 0.7;
-      object->velocity.y = -object->velocity.y * 0.3;
-    }
+  object->force.x = 0.0;
+  object->force.y = 0.0;
+}
+
+/* Position Verlet: x' = 2x - x_prev + a dt^2. The velocity is only
+ * carried along for friction, the walls and the energy readout. */
+static void
+model_step_object_verlet (Model *model, Object *object)
+{
+  Vector acceleration;
+  Point next;
+  double dt = model->dt;
+
+  object->theta += 0.05 * model->dt;
+
+  if (object->immobile) {
+    object->velocity.x = 0;
+    object->velocity.y = 0;
+    object->previous_position = object->position;
+  } else {
+    object->force.x -= model->friction * object->velocity.x;
+    object->force.y -= model->friction * object->velocity.y;
+
+    acceleration.x = object->force.x / object->mass;
+    acceleration.y = object->force.y / object->mass;
+
+    next.x = 2 * object->position.x - object->previous_position.x
+      + acceleration.x * dt * dt;
+    next.y = 2 * object->position.y - object->previous_position.y
+      + acceleration.y * dt * dt;
+
+    object->velocity.x = (next.x - object->position.x) / dt;
+    object->velocity.y = (next.y - object->position.y) / dt;
+    object->position = next;
+
+    object_collide_walls (object);
+
+    object->previous_position.x = object->position.x - object->velocity.x * dt;
+    object->previous_position.y = object->position.y - object->velocity.y * dt;
   }
 
   object->force.x = 0.0;
   object->force.y = 0.0;
 }
 
+/* The spring forces are linear in the positions, so their Jacobian
+ * is a constant -K, with K = k/2 times the graph Laplacian of the
+ * springs. This adds scale * K u to result. */
 static void
-model_step (Model *model)
+model_add_stiffness (Model *model, const Vector *u, Vector *result,
+		     double scale)
+{
+  Spring *spring;
+  Vector d;
+  int i, a, b;
+
+  scale *= 0.5 * model->k;
+  for (i = 0; i < model->num_springs; i++) {
+    spring = &model->springs[i];
+    a = spring->a - model->objects;
+    b = spring->b - model->objects;
+
+    d.x = scale * (u[a].x - u[b].x);
+    d.y = scale * (u[a].y - u[b].y);
+
+    result[a].x += d.x;
+    result[a].y += d.y;
+    result[b].x -= d.x;
+    result[b].y -= d.y;
+  }
+}
+
+/* result = (M + dt c + dt^2 K) u, with immobile objects filtered out. */
+static void
+model_apply_system (Model *model, const Vector *u, Vector *result)
+{
+  Object *object;
+  double diagonal;
+  int i;
+
+  for (i = 0; i < model->num_objects; i++) {
+    object = &model->objects[i];
+    diagonal = object->mass + model->dt * model->friction;
+    result[i].x = diagonal * u[i].x;
+    result[i].y = diagonal * u[i].y;
+  }
+
+  model_add_stiffness (model, u, result, model->dt * model->dt);
+
+  for (i = 0; i < model->num_objects; i++)
+    if (model->objects[i].immobile)
+      result[i].x = result[i].y = 0;
+}
+
+static double
+vector_dot (const Vector *a, const Vector *b, int n)
+{
+  double sum = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += a[i].x * b[i].x + a[i].y * b[i].y;
+
+  return sum;
+}
+
+/* Backward Euler, linearized about the current state (Baraff and
+ * Witkin, "Large Steps in Cloth Simulation"):
+ *
+ *   (M + dt c + dt^2 K) dv = dt (f - dt K v)
+ *
+ * The system is symmetric positive definite, so we solve it with
+ * conjugate gradients, matrix-free, straight off the spring list. The
+ * x and y components decouple but share the matrix, so both are
+ * solved at once.
+ */
+static void
+model_step_implicit (Model *model)
+{
+  int n = model->num_objects;
+  Vector *r  = model->solver_work;
+  Vector *p  = r + n;
+  Vector *ap = p + n;
+  Vector *dv = ap + n;
+  Vector *v  = ap;
+  double dt = model->dt;
+  double rr, rr_new, rr_limit, alpha;
+  Object *object;
+  int i, iteration;
+
+  /* The spring forces have already been accumulated into
+   * object->force. Build the right hand side in r, borrowing ap to
+   * hold the velocities. */
+  for (i = 0; i < n; i++) {
+    v[i] = model->objects[i].velocity;
+    r[i].x = 0;
+    r[i].y = 0;
+  }
+  model_add_stiffness (model, v, r, -dt);
+  for (i = 0; i < n; i++) {
+    object = &model->objects[i];
+    if (object->immobile) {
+      r[i].x = r[i].y = 0;
+    } else {
+      r[i].x = dt * (r[i].x + object->force.x
+		     - model->friction * object->velocity.x);
+      r[i].y = dt * (r[i].y + object->force.y
+		     - model->friction * object->velocity.y);
+    }
+    dv[i].x = dv[i].y = 0;
+    p[i] = r[i];
+  }
+
+  rr = vector_dot (r, r, n);
+  rr_limit = rr * CG_TOLERANCE;
+  for (iteration = 0;
+       iteration < CG_MAX_ITERATIONS && rr > rr_limit && rr > 0;
+       iteration++) {
+    model_apply_system (model, p, ap);
+    alpha = rr / vector_dot (p, ap, n);
+    for (i = 0; i < n; i++) {
+      dv[i].x += alpha * p[i].x;
+      dv[i].y += alpha * p[i].y;
+      r[i].x -= alpha * ap[i].x;
+      r[i].y -= alpha * ap[i].y;
+    }
+    rr_new = vector_dot (r, r, n);
+    for (i = 0; i < n; i++) {
+      p[i].x = r[i].x + rr_new / rr * p[i].x;
+      p[i].y = r[i].y + rr_new / rr * p[i].y;
+    }
+    rr = rr_new;
+  }
+
+  for (i = 0; i < n; i++) {
+    object = &model->objects[i];
+    object->theta += 0.05 * dt;
+
+    if (object->immobile) {
+      object->velocity.x = 0;
+      object->velocity.y = 0;
+    } else {
+      object->velocity.x += dv[i].x;
+      object->velocity.y += dv[i].y;
+
+      object->position.x += object->velocity.x * dt;
+      object->position.y += object->velocity.y * dt;
+
+      object_collide_walls (object);
+    }
+
+    object->force.x = 0.0;
+    object->force.y = 0.0;
+  }
+}
+
+static void
+model_exert_spring_forces (Model *model)
 {
   int i;
 
   for (i = 0; i < model->num_springs; i++)
     spring_exert_forces (&model->springs[i], model->k);
+}
+
+static void
+model_integrate (Model *model)
+{
+  int i;
+
+  switch (model->integrator) {
+  case INTEGRATOR_EULER:
+    for (i = 0; i < model->num_objects; i++)
+      model_step_object (model, &model->objects[i]);
+    break;
+  case INTEGRATOR_VERLET:
+    for (i = 0; i < model->num_objects; i++)
+      model_step_object_verlet (model, &model->objects[i]);
+    break;
+  case INTEGRATOR_IMPLICIT:
+    model_step_implicit (model);
+    break;
+  }
+}
+
+/* Remember where everything was before the next step, so frames can
+ * be drawn part way through it. */
+static void
+model_save_positions (Model *model)
+{
+  int i;
 
   for (i = 0; i < model->num_objects; i++)
-    model_step_object (model, &model->objects[i]);
+    model->objects[i].last_position = model->objects[i].position;
+}
+
+static void
+object_get_render_position (Model *model, Object *object, Point *point)
+{
+  double alpha = model->render_alpha;
+
+  point->x = object->last_position.x +
+    alpha * (object->position.x - object->last_position.x);
+  point->y = object->last_position.y +
+    alpha * (object->position.y - object->last_position.y);
+}
+
+static void
+model_step (Model *model)
+{
+  model_exert_spring_forces (model);
+  model_integrate (model);
+  model_update_index (model);
+}
+
+/* Verlet keeps its velocity implicitly in the previous position, so
+ * that has to be rebuilt whenever the integrator or time step
+ * changes under it. */
+static void
+model_sync_previous_positions (Model *model)
+{
+  Object *object;
+  int i;
+
+  for (i = 0; i < model->num_objects; i++) {
+    object = &model->objects[i];
+    object->previous_position.x =
+      object->position.x - object->velocity.x * model->dt;
+    object->previous_position.y =
+      object->position.y - object->velocity.y * model->dt;
+  }
+}
+
+static void
+model_set_integrator (Model *model, Integrator integrator)
+{
+  model->integrator = integrator;
+  model_sync_previous_positions (model);
+}
+
+static void
+model_set_time_step (Model *model, double dt)
+{
+  model->dt = dt;
+  model_sync_previous_positions (model);
+}
+
+/* Kinetic energy plus the potential energy stored in the springs,
+ * (k/4) |b - a - offset|^2 each, matching spring_exert_forces. */
+static double
+model_energy (Model *model)
+{
+  Object *object;
+  Spring *spring;
+  double energy = 0, dx, dy;
+  int i;
+
+  for (i = 0; i < model->num_objects; i++) {
+    object = &model->objects[i];
+    energy += 0.5 * object->mass * (object->velocity.x * object->velocity.x +
+				    object->velocity.y * object->velocity.y);
+  }
+
+  for (i = 0; i < model->num_springs; i++) {
+    spring = &model->springs[i];
+    dx = spring->b->position.x - spring->a->position.x - spring->offset.x;
+    dy = spring->b->position.y - spring->a->position.y - spring->offset.y;
+    energy += 0.25 * model->k * (dx * dx + dy * dy);
+  }
+
+  return energy;
 }
 
 static cairo_t *
@@ -406,36 +920,162 @@ draw_star (GtkWidget	*widget,
   end_paint (cr);
 }
 
+typedef struct _BezierBasis BezierBasis;
+struct _BezierBasis {
+  int divisions;
+  /* coeffs[i][k] is the k'th cubic Bernstein polynomial at
+   * t = i / divisions */
+  double (*coeffs)[4];
+};
+
 static void
-evaluate_bezier_point (Object *objects,
-		       double u, double v,
-		       double *patch_x, double *patch_y)
+bezier_coefficients (double t, double coeffs[4])
 {
-  double coeffs_u[4], coeffs_v[4];
-  double x, y;
+  coeffs[0] = (1 - t) * (1 - t) * (1 - t);
+  coeffs[1] = 3 * t * (1 - t) * (1 - t);
+  coeffs[2] = 3 * t * t * (1 - t);
+  coeffs[3] = t * t * t;
+}
+
+/* Bernstein tables are built once per sampling density and kept. */
+static const BezierBasis *
+bezier_basis_get (int divisions)
+{
+  static BezierBasis cache[BEZIER_MAX_DIVISIONS + 1];
+  BezierBasis *basis;
+  int i;
+
+  g_assert (divisions > 0 && divisions <= BEZIER_MAX_DIVISIONS);
+
+  basis = &cache[divisions];
+  if (basis->coeffs == NULL) {
+    basis->divisions = divisions;
+    basis->coeffs = g_malloc ((divisions + 1) * sizeof (basis->coeffs[0]));
+    for (i = 0; i <= divisions; i++)
+      bezier_coefficients ((double) i / divisions, basis->coeffs[i]);
+  }
+
+  return basis;
+}
+
+/* Copy the 16 control points of patch (px, py) out of the mesh,
+ * row-major as control[j * 4 + i]. */
+static void
+model_get_patch (Model *model, int px, int py, Point control[16])
+{
+  Object *row;
   int i, j;
 
-  coeffs_u[0] = (1 - u) * (1 - u) * (1 - u);
-  coeffs_u[1] = 3 * u * (1 - u) * (1 - u);
-  coeffs_u[2] = 3 * u * u * (1 - u);
-  coeffs_u[3] = u * u * u;
+  for (j = 0; j < 4; j++) {
+    row = &model->objects[(3 * py + j) * model->grid_width + 3 * px];
+    for (i = 0; i < 4; i++)
+      object_get_render_position (model, &row[i], &control[j * 4 + i]);
+  }
+}
 
-  coeffs_v[0] = (1 - v) * (1 - v) * (1 - v);
-  coeffs_v[1] = 3 * v * (1 - v) * (1 - v);
-  coeffs_v[2] = 3 * v * v * (1 - v);
-  coeffs_v[3] = v * v * v;
+/* Every iso-parameter line of a bicubic patch is itself a cubic
+ * Bezier curve. Collapse the patch against the Bernstein weights of
+ * the fixed parameter to get that curve's four control points.
+ * stride_fixed/stride_free step through the control net along the
+ * fixed and the free parameter respectively. */
+static void
+patch_collapse (const Point control[16], const double weights[4],
+		int stride_fixed, int stride_free, Point curve[4])
+{
+  int i, k;
+
+  for (k = 0; k < 4; k++) {
+    curve[k].x = 0;
+    curve[k].y = 0;
+    for (i = 0; i < 4; i++) {
+      curve[k].x += weights[i] * control[i * stride_fixed + k * stride_free].x;
+      curve[k].y += weights[i] * control[i * stride_fixed + k * stride_free].y;
+    }
+  }
+}
 
-  x = 0;
-  y = 0;
-  for (i = 0; i < 4; i++)
-    for (j = 0; j < 4; j++)
-      {
-	x += coeffs_u[i] * coeffs_v[j] * objects[j * 4 + i].position.x;
-	y += coeffs_u[i] * coeffs_v[j] * objects[j * 4 + i].position.y;
-      }
+/* Number of chords needed to stay within tolerance of the curve: the
+ * chord error of n uniform steps is bounded by max|C''| / (8 n^2),
+ * and max|C''| <= 6 max |Q[i] - 2 Q[i+1] + Q[i+2]|. */
+static int
+curve_segments (const Point curve[4], double tolerance)
+{
+  double d1, d2, dd;
+  int n;
 
-  *patch_x = x;
-  *patch_y = y;
+  d1 = hypot (curve[0].x - 2 * curve[1].x + curve[2].x,
+	      curve[0].y - 2 * curve[1].y + curve[2].y);
+  d2 = hypot (curve[1].x - 2 * curve[2].x + curve[3].x,
+	      curve[1].y - 2 * curve[2].y + curve[3].y);
+  dd = MAX (d1, d2);
+
+  n = ceil (sqrt (0.75 * dd / tolerance));
+
+  return CLAMP (n, 1, BEZIER_MAX_DIVISIONS);
+}
+
+/* Append a cubic to the path with n chords, stepping along it by
+ * forward differences: three additions per point instead of a full
+ * Bernstein evaluation. */
+static void
+curve_forward_difference (cairo_t *cr, const Point curve[4], int n)
+{
+  Point a, b, c;
+  Point f, df, ddf, dddf;
+  double h = 1.0 / n;
+  int i;
+
+  /* Power basis: C(t) = a t^3 + b t^2 + c t + curve[0] */
+  a.x = curve[3].x - curve[0].x + 3 * (curve[1].x - curve[2].x);
+  a.y = curve[3].y - curve[0].y + 3 * (curve[1].y - curve[2].y);
+  b.x = 3 * (curve[0].x - 2 * curve[1].x + curve[2].x);
+  b.y = 3 * (curve[0].y - 2 * curve[1].y + curve[2].y);
+  c.x = 3 * (curve[1].x - curve[0].x);
+  c.y = 3 * (curve[1].y - curve[0].y);
+
+  f = curve[0];
+  df.x = a.x * h * h * h + b.x * h * h + c.x * h;
+  df.y = a.y * h * h * h + b.y * h * h + c.y * h;
+  ddf.x = 6 * a.x * h * h * h + 2 * b.x * h * h;
+  ddf.y = 6 * a.y * h * h * h + 2 * b.y * h * h;
+  dddf.x = 6 * a.x * h * h * h;
+  dddf.y = 6 * a.y * h * h * h;
+
+  cairo_move_to (cr, f.x, f.y);
+  for (i = 1; i < n; i++) {
+    f.x += df.x;
+    f.y += df.y;
+    df.x += ddf.x;
+    df.y += ddf.y;
+    ddf.x += dddf.x;
+    ddf.y += dddf.y;
+    cairo_line_to (cr, f.x, f.y);
+  }
+  /* Land exactly on the end point rather than accumulate error */
+  cairo_line_to (cr, curve[3].x, curve[3].y);
+}
+
+/* Draw the iso-lines of one patch. The lines on the leading edges
+ * are skipped when a neighbouring patch has already drawn them. */
+static void
+draw_patch_grid (cairo_t *cr, const Point control[16],
+		 int skip_first_u, int skip_first_v, double tolerance)
+{
+  const BezierBasis *basis = bezier_basis_get (PATCH_GRID_DIVISIONS);
+  Point curve[4];
+  int i;
+
+  /* Lines of constant u, running along v */
+  for (i = skip_first_u; i <= basis->divisions; i++) {
+    patch_collapse (control, basis->coeffs[i], 1, 4, curve);
+    curve_forward_difference (cr, curve, curve_segments (curve, tolerance));
+  }
+
+  /* Lines of constant v, running along u */
+  for (i = skip_first_v; i <= basis->divisions; i++) {
+    patch_collapse (control, basis->coeffs[i], 4, 1, curve);
+    curve_forward_difference (cr, curve, curve_segments (curve, tolerance));
+  }
 }
 
 static void
@@ -443,37 +1083,26 @@ draw_spline_grid (GtkWidget	*widget,
 		  Model      *model)
 {
   cairo_t *cr;
-  double u, v;
-  double x, y;
+  Point control[16];
+  double tolerance, unused = 0;
+  int px, py;
 
   cr = begin_paint (widget->window);
 
   cairo_set_source_rgb (cr, 0, 0, 0);
   cairo_set_line_width (cr, 1.0);
 
-  cairo_new_path (cr);
-  for (u = 0; u <= 1.01; u += 0.2)
-    {
-      for (v = 0; v <= 1.01; v += 0.05)
-	{
-	  evaluate_bezier_point (model->objects, u, v, &x, &y);
-	  if (v == 0)
-	    cairo_move_to (cr, x, y);
-	  else
-	    cairo_line_to (cr, x, y);
-	}
-    }
+  /* cairo's tolerance is in device space, so bring it back to user
+   * space where the control points live. */
+  tolerance = cairo_get_tolerance (cr);
+  cairo_device_to_user_distance (cr, &tolerance, &unused);
+  tolerance = fabs (tolerance);
 
-  for (v = 0; v <= 1.01; v += 0.2)
-    {
-      for (u = 0; u <= 1.01; u += 0.05)
-	{
-	  evaluate_bezier_point (model->objects, u, v, &x, &y);
-	  if (u == 0)
-	    cairo_move_to (cr, x, y);
-	  else
-	    cairo_line_to (cr, x, y);
-	}
+  cairo_new_path (cr);
+  for (py = 0; py < (model->grid_height - 1) / 3; py++)
+    for (px = 0; px < (model->grid_width - 1) / 3; px++) {
+      model_get_patch (model, px, py, control);
+      draw_patch_grid (cr, control, px > 0, py > 0, tolerance);
     }
 
   cairo_stroke (cr);
@@ -482,6 +1111,31 @@ draw_spline_grid (GtkWidget	*widget,
 }
 
 #if 0
+static void
+evaluate_bezier_point (const Point control[16],
+		       double u, double v,
+		       double *patch_x, double *patch_y)
+{
+  double coeffs_u[4], coeffs_v[4];
+  double x, y;
+  int i, j;
+
+  bezier_coefficients (u, coeffs_u);
+  bezier_coefficients (v, coeffs_v);
+
+  x = 0;
+  y = 0;
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 4; j++)
+      {
+	x += coeffs_u[i] * coeffs_v[j] * control[j * 4 + i].x;
+	y += coeffs_u[i] * coeffs_v[j] * control[j * 4 + i].y;
+      }
+
+  *patch_x = x;
+  *patch_y = y;
+}
+
 static void
 draw_spline_spiral (GtkWidget	*widget,
 		    Model      *model)
@@ -489,6 +1143,9 @@ draw_spline_spiral (GtkWidget	*widget,
   cairo_t *cr;
   double u, v, r, phi, offset;
   double x, y;
+  Point control[16];
+
+  model_get_patch (model, 0, 0, control);
 
   cr = begin_paint (widget->window);
 
@@ -503,7 +1160,7 @@ draw_spline_spiral (GtkWidget	*widget,
       u = cos (phi) * (r + offset) + 0.5;
       v = sin (phi) * (r + offset)+ 0.5;
       offset = -offset;
-      evaluate_bezier_point (model->objects, u, v, &x, &y);
+      evaluate_bezier_point (control, u, v, &x, &y);
       if (phi < 0.05)
 	cairo_move_to (cr, x, y);
       else
@@ -544,6 +1201,7 @@ sproing_expose_event (GtkWidget      *widget,
 		      gpointer	      data)
 {
   Model *model = data;
+  Point point;
   int i;
 
   draw_wall (widget);
@@ -554,15 +1212,15 @@ sproing_expose_event (GtkWidget      *widget,
   draw_spline_grid (widget, model);
 #endif
 
-  if (model->anchor_object)
-    draw_ball (widget,
-	       model->anchor_object->position.x,
-	       model->anchor_object->position.y, &red);
+  if (model->anchor_object) {
+    object_get_render_position (model, model->anchor_object, &point);
+    draw_ball (widget, point.x, point.y, &red);
+  }
 
 #if 1
   for (i = 0; i < model->num_objects; i++) {
-    draw_star (widget, model->objects[i].position.x,
-	       model->objects[i].position.y, model->objects[i].theta, &blue);
+    object_get_render_position (model, &model->objects[i], &point);
+    draw_star (widget, point.x, point.y, model->objects[i].theta, &blue);
   }
 #endif
 
@@ -580,22 +1238,51 @@ object_distance (Object *object, double x, double y)
   return sqrt (dx*dx + dy*dy);
 }
 
+typedef struct _NearestClosure NearestClosure;
+struct _NearestClosure {
+  Object *object;
+  double distance;
+};
+
+static void
+nearest_closure_add (Object *object, double distance, void *data)
+{
+  NearestClosure *nearest = data;
+
+  if (nearest->object == NULL || distance < nearest->distance) {
+    nearest->object = object;
+    nearest->distance = distance;
+  }
+}
+
+/* Search ever larger discs around (x, y) until one holds an object;
+ * the closest object in that disc is the closest overall. Once a
+ * search would touch more cells than there are objects, a plain scan
+ * is cheaper. */
 static Object *
 model_find_nearest (Model *model, double x, double y)
 {
-  Object *object;
-  double distance, min_distance;
-  int i;
+  NearestClosure nearest;
+  double radius, distance;
+  int i, cells;
+
+  nearest.object = NULL;
+  radius = model->index.cell_size;
+  do {
+    cells = spatial_index_foreach_in_radius (&model->index, model->objects,
+					     x, y, radius,
+					     nearest_closure_add, &nearest);
+    if (nearest.object)
+      return nearest.object;
+    radius *= 2;
+  } while (cells < model->num_objects);
 
   for (i = 0; i < model->num_objects; i++) {
     distance = object_distance (&model->objects[i], x, y);
-    if (i == 0 || distance < min_distance) {
-      min_distance = distance;
-      object = &model->objects[i];
-    }
+    nearest_closure_add (&model->objects[i], distance, &nearest);
   }
 
-  return object;
+  return nearest.object;
 }
 
 static gboolean
@@ -638,6 +1325,9 @@ sproing_button_press_event (GtkWidget	   *widget,
 
   model->anchor_object->position.x = x;
   model->anchor_object->position.y = y;
+  spatial_index_update (&model->index,
+			model->anchor_object - model->objects,
+			&model->anchor_object->position);
 
   return TRUE;
 }
@@ -656,6 +1346,9 @@ sproing_motion_notify_event (GtkWidget	    *widget,
   if (state & GDK_BUTTON1_MASK) {
     model->anchor_object->position.x = x + 0.5;
     model->anchor_object->position.y = y + 0.5;
+    spatial_index_update (&model->index,
+			  model->anchor_object - model->objects,
+			  &model->anchor_object->position);
   }
 
   return TRUE;
@@ -677,11 +1370,28 @@ friction_changed (GtkSpinButton *spinbutton, gpointer user_data)
   model->friction = gtk_spin_button_get_value (spinbutton);
 }
 
+static void
+time_step_changed (GtkSpinButton *spinbutton, gpointer user_data)
+{
+  Model *model = user_data;
+
+  model_set_time_step (model, gtk_spin_button_get_value (spinbutton));
+}
+
+static void
+integrator_changed (GtkComboBox *combo, gpointer user_data)
+{
+  Model *model = user_data;
+
+  model_set_integrator (model, gtk_combo_box_get_active (combo));
+}
+
 static GtkWidget *
 create_spinners (Model *model)
 {
   GtkWidget *hbox;
-  GtkWidget *spinner, *label;
+  GtkWidget *spinner, *label, *combo;
+  int i;
 
   hbox = gtk_hbox_new (FALSE, 8);
 
@@ -703,11 +1413,31 @@ create_spinners (Model *model)
   g_signal_connect (spinner, "value-changed",
 		    G_CALLBACK (friction_changed), model);
 
+  label = gtk_label_new_with_mnemonic ("_Time step:");
+  gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+  spinner = gtk_spin_button_new_with_range  (0.005, 10.00, 0.005);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), spinner);
+  gtk_box_pack_start (GTK_BOX (hbox), spinner, FALSE, FALSE, 0);
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (spinner), model->dt);
+  g_signal_connect (spinner, "value-changed",
+		    G_CALLBACK (time_step_changed), model);
+
+  label = gtk_label_new_with_mnemonic ("_Integrator:");
+  gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+  combo = gtk_combo_box_new_text ();
+  for (i = 0; i < G_N_ELEMENTS (integrator_names); i++)
+    gtk_combo_box_append_text (GTK_COMBO_BOX (combo), integrator_names[i]);
+  gtk_combo_box_set_active (GTK_COMBO_BOX (combo), model->integrator);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), combo);
+  gtk_box_pack_start (GTK_BOX (hbox), combo, FALSE, FALSE, 0);
+  g_signal_connect (combo, "changed",
+		    G_CALLBACK (integrator_changed), model);
+
   return hbox;
 }
 
 static GtkWidget *
-create_window (Model *model)
+create_window (Model *model, GtkWidget **status)
 {
   GtkWidget *window;
   GtkWidget *frame;
@@ -768,44 +1498,296 @@ create_window (Model *model)
   spinners = create_spinners (model);
   gtk_box_pack_start (GTK_BOX (vbox), spinners, FALSE, FALSE, 0);
 
+  *status = gtk_label_new (NULL);
+  gtk_misc_set_alignment (GTK_MISC (*status), 0.0, 0.5);
+  gtk_box_pack_start (GTK_BOX (vbox), *status, FALSE, FALSE, 0);
+
   return da;
 }
 
 typedef struct _Closure Closure;
 struct _Closure {
   GtkWidget *drawing_area;
+  GtkWidget *status;
   Model *model;
-  int i;
+
+  /* Physics clock: model time not yet simulated */
+  GTimer *clock;
+  double accumulator;
+
+  /* Statistics for the status line */
+  GTimer *report_timer;
+  GTimer *step_timer;
+  double step_seconds;
+  int steps;
+  double energy;
 };
 
+#define REPORT_INTERVAL 1.0
+
+static void
+update_status (Closure *closure)
+{
+  double elapsed, energy;
+  char *text;
+
+  elapsed = g_timer_elapsed (closure->report_timer, NULL);
+  if (elapsed < REPORT_INTERVAL)
+    return;
+
+  energy = model_energy (closure->model);
+  text = g_strdup_printf ("%s: %.0f steps/sec, energy %.1f (drift %+.2f/sec)",
+			  integrator_names[closure->model->integrator],
+			  closure->step_seconds > 0 ?
+			  closure->steps / closure->step_seconds : 0,
+			  energy, (energy - closure->energy) / elapsed);
+  gtk_label_set_text (GTK_LABEL (closure->status), text);
+  g_free (text);
+
+  closure->energy = energy;
+  closure->steps = 0;
+  closure->step_seconds = 0;
+  g_timer_start (closure->report_timer);
+}
+
+/* Run as many fixed physics steps as the wall clock calls for since
+ * the last frame, then draw once, interpolated to the current time.
+ * How long a frame takes to draw only changes how many steps the
+ * next one batches up, not how the model evolves. */
 static gint
 timeout_callback (gpointer data)
 {
   Closure *closure = data;
+  Model *model = closure->model;
+  int steps;
+
+  closure->accumulator +=
+    g_timer_elapsed (closure->clock, NULL) * MODEL_TIME_PER_SECOND;
+  g_timer_start (closure->clock);
 
-  model_step (closure->model);
-  closure->i++;
-  if (closure->i == 1) {
-    gtk_widget_queue_draw (closure->drawing_area);
-    closure->i = 0;
+  steps = closure->accumulator / model->dt;
+  if (steps > MAX_STEPS_PER_FRAME) {
+    steps = MAX_STEPS_PER_FRAME;
+    closure->accumulator = steps * model->dt;
   }
 
+  if (steps > 0) {
+    g_timer_start (closure->step_timer);
+    while (steps--) {
+      if (steps == 0)
+	model_save_positions (model);
+      model_step (model);
+      closure->accumulator -= model->dt;
+      closure->steps++;
+    }
+    closure->step_seconds += g_timer_elapsed (closure->step_timer, NULL);
+  }
+
+  model->render_alpha = CLAMP (closure->accumulator / model->dt, 0.0, 1.0);
+
+  update_status (closure);
+
+  gtk_widget_queue_draw (closure->drawing_area);
+
   return TRUE;
 }
 
+/* Trace files are a small header followed by one frame per step (plus
+ * the initial state), each frame num_objects (x, y) pairs of floats,
+ * all in host byte order:
+ *
+ *   char    magic[4] = "SPRT"
+ *   guint32 version = 1
+ *   guint32 num_objects
+ *   guint32 num_frames
+ */
+#define TRACE_MAGIC "SPRT"
+#define TRACE_VERSION 1
+
+static FILE *
+trace_open (const char *filename, Model *model, int num_frames)
+{
+  guint32 header[3];
+  FILE *file;
+
+  file = fopen (filename, "wb");
+  if (file == NULL)
+    return NULL;
+
+  header[0] = TRACE_VERSION;
+  header[1] = model->num_objects;
+  header[2] = num_frames;
+  fwrite (TRACE_MAGIC, 1, 4, file);
+  fwrite (header, sizeof (header), 1, file);
+
+  return file;
+}
+
+static void
+trace_write_frame (FILE *file, Model *model, float *buffer)
+{
+  int i;
+
+  for (i = 0; i < model->num_objects; i++) {
+    buffer[2 * i]     = model->objects[i].position.x;
+    buffer[2 * i + 1] = model->objects[i].position.y;
+  }
+  fwrite (buffer, sizeof (float), 2 * model->num_objects, file);
+}
+
+static int num_patches = DEFAULT_PATCHES;
+static gboolean bench = FALSE;
+static int bench_width = 100;
+static int bench_height = 100;
+static int bench_steps = 1000;
+static char *bench_integrator = NULL;
+static double bench_time_step = DEFAULT_TIME_STEP;
+static char *bench_trace = NULL;
+
+static GOptionEntry options[] = {
+  { "patches", 'p', 0, G_OPTION_ARG_INT, &num_patches,
+    "Number of Bezier patches along each side of the mesh", "N" },
+  { "bench", 'b', 0, G_OPTION_ARG_NONE, &bench,
+    "Run the simulation without a display and report timings", NULL },
+  { "width", 0, 0, G_OPTION_ARG_INT, &bench_width,
+    "Benchmark mesh width in objects (default 100)", "N" },
+  { "height", 0, 0, G_OPTION_ARG_INT, &bench_height,
+    "Benchmark mesh height in objects (default 100)", "N" },
+  { "steps", 'n', 0, G_OPTION_ARG_INT, &bench_steps,
+    "Number of benchmark steps (default 1000)", "N" },
+  { "integrator", 'i', 0, G_OPTION_ARG_STRING, &bench_integrator,
+    "Benchmark integrator: euler, verlet or implicit", "NAME" },
+  { "time-step", 't', 0, G_OPTION_ARG_DOUBLE, &bench_time_step,
+    "Benchmark time step (default 0.01)", "DT" },
+  { "trace", 0, 0, G_OPTION_ARG_FILENAME, &bench_trace,
+    "Write object positions for every step to FILE", "FILE" },
+  { NULL }
+};
+
+static int
+run_bench (void)
+{
+  Model model;
+  GTimer *timer;
+  double springs = 0, integrate = 0, index = 0, trace = 0, total;
+  double energy;
+  FILE *trace_file = NULL;
+  float *trace_buffer = NULL;
+  int i, step;
+
+  model_init (&model, MAX (bench_width, 1), MAX (bench_height, 1));
+
+  if (bench_integrator) {
+    for (i = 0; i < G_N_ELEMENTS (integrator_names); i++)
+      if (g_ascii_strcasecmp (bench_integrator, integrator_names[i]) == 0)
+	break;
+    if (i == G_N_ELEMENTS (integrator_names)) {
+      g_printerr ("Unknown integrator: %s\n", bench_integrator);
+      return 1;
+    }
+    model_set_integrator (&model, i);
+  }
+  model_set_time_step (&model, bench_time_step);
+
+  if (bench_trace) {
+    trace_file = trace_open (bench_trace, &model, bench_steps + 1);
+    if (trace_file == NULL) {
+      g_printerr ("Failed to open %s\n", bench_trace);
+      return 1;
+    }
+    trace_buffer = g_new (float, 2 * model.num_objects);
+    trace_write_frame (trace_file, &model, trace_buffer);
+  }
+
+  g_print ("sproing-bench: %dx%d mesh, %d objects, %d springs, %s, dt %g\n",
+	   model.grid_width, model.grid_height,
+	   model.num_objects, model.num_springs,
+	   integrator_names[model.integrator], model.dt);
+
+  energy = model_energy (&model);
+  timer = g_timer_new ();
+  for (step = 0; step < bench_steps; step++) {
+    g_timer_start (timer);
+    model_exert_spring_forces (&model);
+    springs += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    model_integrate (&model);
+    integrate += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    model_update_index (&model);
+    index += g_timer_elapsed (timer, NULL);
+
+    if (trace_file) {
+      g_timer_start (timer);
+      trace_write_frame (trace_file, &model, trace_buffer);
+      trace += g_timer_elapsed (timer, NULL);
+    }
+  }
+  g_timer_destroy (timer);
+
+  total = springs + integrate + index;
+  g_print ("%d steps in %.3f sec: %.1f steps/sec\n",
+	   bench_steps, total, total > 0 ? bench_steps / total : 0);
+  g_print ("  spring forces %8.3f sec (%4.1f%%)\n", springs,
+	   total > 0 ? 100 * springs / total : 0);
+  g_print ("  integration   %8.3f sec (%4.1f%%)\n", integrate,
+	   total > 0 ? 100 * integrate / total : 0);
+  g_print ("  index update  %8.3f sec (%4.1f%%)\n", index,
+	   total > 0 ? 100 * index / total : 0);
+  g_print ("energy %g -> %g\n", energy, model_energy (&model));
+
+  if (trace_file) {
+    g_print ("trace: %d frames to %s in %.3f sec\n",
+	     bench_steps + 1, bench_trace, trace);
+    fclose (trace_file);
+    g_free (trace_buffer);
+  }
+
+  return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
   Closure closure;
   Model model;
+  GOptionContext *context;
+  GError *error = NULL;
+
+  /* Don't open the display yet: --bench runs without one. */
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (FALSE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (bench)
+    return run_bench ();
 
   gtk_init (&argc, &argv);
-  model_init (&model);
-  closure.drawing_area = create_window (&model);
-  closure.i = 0;
+  if (num_patches < 1)
+    num_patches = 1;
+
+  model_init (&model, 3 * num_patches + 1, 3 * num_patches + 1);
+  closure.drawing_area = create_window (&model, &closure.status);
   gtk_widget_show_all (gtk_widget_get_toplevel (closure.drawing_area));
   closure.model = &model;
-  g_timeout_add (100, timeout_callback, &closure);
+  closure.report_timer = g_timer_new ();
+  closure.step_timer = g_timer_new ();
+  closure.step_seconds = 0;
+  closure.steps = 0;
+  closure.energy = model_energy (&model);
+  closure.clock = g_timer_new ();
+  closure.accumulator = 0;
+  /* GTK+ 2 has no frame clock to sync to, so ask for about 60 Hz
+   * at redraw priority and let the expose coalesce behind it. */
+  g_timeout_add_full (GDK_PRIORITY_REDRAW, FRAME_INTERVAL,
+		      timeout_callback, &closure, NULL);
   gtk_main ();
 
   return 0;
@@ -19,9 +19,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include <cairo.h>
 #include <cairo-xlib.h>
@@ -29,6 +32,8 @@
 #include <assert.h>
 
 #define ARRAY_SIZE(a) (sizeof(a)/sizeof(a[0]))
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
 
 #define SHRINK(cr, x) cairo_translate (cr, (1-(x))/2.0, (1-(x))/2.0); cairo_scale (cr, (x), (x))
 
@@ -40,11 +45,15 @@ typedef enum { SHADING_EMPTY, SHADING_STRIPED, SHADING_SOLID } shading_t;
 typedef enum { SHAPE_DIAMOND, SHAPE_OVAL, SHAPE_SQUIGGLE } shape_t;
 #define NUM_SHAPES (SHAPE_SQUIGGLE + 1)
 
+/* Every attribute takes one of three values, so a card is a 4-digit
+ * base-3 number, held in code (see card_code). Any two cards
+ * determine the third card of their set, digit by digit. */
 typedef struct card {
     int number;
     color_t color;
     shading_t shading;
     shape_t shape;
+    int code;
 } card_t;
 
 #define DECK_MAX_CARDS (NUM_NUMBERS * NUM_COLORS * NUM_SHADINGS * NUM_SHAPES)
@@ -62,14 +71,25 @@ typedef struct slot {
 #define BOARD_COLS 3
 #define BOARD_ROWS 4
 #define BOARD_MAX_SLOTS (BOARD_COLS * BOARD_ROWS)
+/* Only BOARD_MAX_SLOTS are ever shown, but a board can be as large as
+ * the whole deck for solver experiments. */
+#define BOARD_MAX_SIZE DECK_MAX_CARDS
+
+/* Each slot, the old and new sets-possible number, and the margins */
+#define WIN_MAX_DAMAGE (BOARD_MAX_SLOTS + 3)
 typedef struct board {
     int num_slots;
-    slot_t slots[BOARD_MAX_SLOTS];
+    slot_t slots[BOARD_MAX_SIZE];
     int needs_deal;
     int sets_possible;
     int display_sets_possible;
 } board_t;
 
+/* xorshift64*, so every game-playing thread can have its own. */
+typedef struct rng {
+    uint64_t state;
+} rng_t;
+
 typedef struct win {
     Display *dpy;
     int scr;
@@ -86,6 +106,18 @@ typedef struct win {
     int active;
     int display_sets_possible;
 
+    /* Every card pre-rendered at the current slot size, plain and
+     * highlighted, created on first use. */
+    int slot_width, slot_height;
+    cairo_surface_t *card_cache[DECK_MAX_CARDS][2];
+
+    /* What the pixmap currently shows, so only changes get redrawn */
+    int drawn_width, drawn_height;
+    int drawn_sets_possible;	/* the number shown, or -1 */
+    XRectangle drawn_sets_possible_rect;
+    slot_t drawn[BOARD_MAX_SLOTS];
+
+    rng_t rng;
     deck_t deck;
     board_t board;
 } win_t;
@@ -120,6 +152,9 @@ static int quit_cb(win_t *win);
 static void
 board_count_sets_possible (board_t *board);
 
+static void rng_init (rng_t *rng, uint64_t seed);
+static int batch_run (long games, int threads, uint64_t seed);
+
 static const callback_doc_t callback_doc[] = {
     { new_game_cb,      "New game" },
     { reshuffle_cb,	"Return dealt cards to deck and reshuffle" },
@@ -135,14 +170,46 @@ static key_binding_t key_binding[] = {
     { "Q",	0, 0, quit_cb }
 };
 
+static void
+usage (const char *program)
+{
+    fprintf (stderr,
+	     "Usage: %s [--batch GAMES [--threads N] [--seed SEED]]\n"
+	     "\n"
+	     "With --batch, play GAMES games without a display, spread over\n"
+	     "N threads (default: one per processor), and print statistics.\n",
+	     program);
+}
+
 int
-main(void)
+main(int argc, char *argv[])
 {
     win_t win;
+    Display *dpy;
+    long batch_games = 0;
+    int threads = sysconf (_SC_NPROCESSORS_ONLN);
+    uint64_t seed = time (0);
+    int i;
+
+    for (i = 1; i < argc; i++) {
+	if (strcmp (argv[i], "--batch") == 0 && i + 1 < argc)
+	    batch_games = atol (argv[++i]);
+	else if (strcmp (argv[i], "--threads") == 0 && i + 1 < argc)
+	    threads = atoi (argv[++i]);
+	else if (strcmp (argv[i], "--seed") == 0 && i + 1 < argc)
+	    seed = strtoull (argv[++i], NULL, 0);
+	else {
+	    usage (argv[0]);
+	    return 1;
+	}
+    }
+
+    if (batch_games > 0)
+	return batch_run (batch_games, threads < 1 ? 1 : threads, seed);
 
-    Display *dpy = XOpenDisplay(0);
+    dpy = XOpenDisplay(0);
 
-    srand (time(0));
+    rng_init (&win.rng, seed);
 
     if (dpy == NULL) {
 	fprintf(stderr, "Failed to open display: %s\n", XDisplayName(0));
@@ -305,34 +372,38 @@ draw_card (cairo_t *cr, card_t *card, int highlight)
     cairo_restore (cr);
 }
 
+static int
+card_code (card_t *card)
+{
+    return (card->number - 1)
+	+ NUM_NUMBERS * (card->color
+	+ NUM_COLORS * (card->shading
+	+ NUM_SHADINGS * card->shape));
+}
+
+/* Each attribute of a set is either all the same or all different,
+ * which for values in {0,1,2} means the three of them sum to 0 mod 3.
+ * So the third card has digits (-a - b) mod 3. */
+static int
+card_code_third (int a, int b)
+{
+    int third = 0, place = 1;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+	third += ((6 - a % 3 - b % 3) % 3) * place;
+	a /= 3;
+	b /= 3;
+	place *= 3;
+    }
+
+    return third;
+}
+
 static int
 is_set (card_t *a, card_t *b, card_t *c)
 {
-    return (
-	    (
-	     (a->number == b->number && b->number == c->number && a->number == c->number)
-	     ||
-	     (a->number != b->number && b->number != c->number && a->number != c->number)
-	    )
-	    &&
-	    (
-	     (a->color == b->color && b->color == c->color && a->color == c->color)
-	     ||
-	     (a->color != b->color && b->color != c->color && a->color != c->color)
-	    )
-	    &&
-	    (
-	     (a->shading == b->shading && b->shading == c->shading && a->shading == c->shading)
-	     ||
-	     (a->shading != b->shading && b->shading != c->shading && a->shading != c->shading)
-	    )
-	    &&
-	    (
-	     (a->shape == b->shape && b->shape == c->shape && a->shape == c->shape)
-	     ||
-	     (a->shape != b->shape && b->shape != c->shape && a->shape != c->shape)
-	    )
-	   );
+    return card_code_third (a->code, b->code) == c->code;
 }
 
 static int
@@ -381,64 +452,227 @@ board_click (board_t *board, double x, double y)
 }
 
 static void
-draw_board (cairo_t *cr, board_t *board, int width, int height)
+win_flush_card_cache (win_t *win)
 {
     int i;
 
-    cairo_save (cr);
+    for (i=0; i < DECK_MAX_CARDS; i++) {
+	if (win->card_cache[i][0])
+	    cairo_surface_destroy (win->card_cache[i][0]);
+	if (win->card_cache[i][1])
+	    cairo_surface_destroy (win->card_cache[i][1]);
+	win->card_cache[i][0] = NULL;
+	win->card_cache[i][1] = NULL;
+    }
+}
 
-    cairo_scale (cr, width, height);
+static cairo_surface_t *
+win_get_card_surface (win_t *win, card_t *card, int highlight)
+{
+    cairo_surface_t **cached = &win->card_cache[card->code][highlight != 0];
+    cairo_t *cr;
 
-    for (i=0; i < board->num_slots; i++)
-	if (board->slots[i].has_card) {
-	    cairo_save (cr);
-	    cairo_translate (cr,
-			     1.0/BOARD_COLS * (i % BOARD_COLS),
-			     1.0/BOARD_ROWS * (i / BOARD_COLS));
-	    cairo_scale (cr, 1.0/BOARD_COLS, 1.0/BOARD_ROWS);
-	    draw_card (cr, &board->slots[i].card, board->slots[i].selected);
-	    cairo_restore (cr);
-	}
+    if (*cached)
+	return *cached;
+
+    *cached = cairo_surface_create_similar (win->surface, CAIRO_CONTENT_COLOR,
+					    win->slot_width, win->slot_height);
+    cr = cairo_create (*cached);
+
+    cairo_set_source_rgb (cr, 1, 1, 1);
+    cairo_paint (cr);
+
+    cairo_scale (cr, win->slot_width, win->slot_height);
+    draw_card (cr, card, highlight);
+
+    cairo_destroy (cr);
+
+    return *cached;
+}
+
+static int
+slot_changed (slot_t *a, slot_t *b)
+{
+    if (a->has_card != b->has_card)
+	return 1;
+
+    if (! a->has_card)
+	return 0;
+
+    return a->card.code != b->card.code || a->selected != b->selected;
+}
 
+static void
+win_slot_rectangle (win_t *win, int i, XRectangle *rect)
+{
+    rect->x = (i % BOARD_COLS) * win->slot_width;
+    rect->y = (i / BOARD_COLS) * win->slot_height;
+    rect->width = win->slot_width;
+    rect->height = win->slot_height;
+}
+
+static void
+win_draw_slot (win_t *win, cairo_t *cr, int i)
+{
+    slot_t *slot = &win->board.slots[i];
+    XRectangle rect;
+
+    win_slot_rectangle (win, i, &rect);
+
+    if (slot->has_card)
+	cairo_set_source_surface (cr,
+				  win_get_card_surface (win, &slot->card,
+							slot->selected),
+				  rect.x, rect.y);
+    else
+	cairo_set_source_rgb (cr, 1, 1, 1);
+
+    cairo_rectangle (cr, rect.x, rect.y, rect.width, rect.height);
+    cairo_fill (cr);
+
+    win->drawn[i] = *slot;
+}
+
+static void
+win_set_sets_possible_font (win_t *win, cairo_t *cr,
+			    char *sets_possible, cairo_text_extents_t *extents)
+{
+    snprintf (sets_possible, 3, "%d", win->board.sets_possible);
+    sets_possible[2] = '\0';
+
+    cairo_select_font_face (cr, "sans", 0, 0);
+    cairo_set_font_size (cr, win->height / 1.2);
+    cairo_text_extents (cr, sets_possible, extents);
+}
+
+static void
+win_draw_sets_possible (win_t *win, cairo_t *cr)
+{
+    char sets_possible[3];
+    cairo_text_extents_t extents;
+
+    cairo_save (cr);
+    {
+	win_set_sets_possible_font (win, cr, sets_possible, &extents);
+	cairo_move_to (cr,
+		       win->width/2 - (extents.x_bearing + extents.width/2),
+		       win->height/2 - (extents.y_bearing + extents.height/2));
+	cairo_set_source_rgba (cr, 0, 0, .5, 0.75);
+	cairo_show_text (cr, sets_possible);
+    }
     cairo_restore (cr);
 }
 
+/* The pixels the sets-possible number covers, rounded out and padded
+ * by a pixel for antialiasing. */
+static void
+win_sets_possible_rectangle (win_t *win, cairo_t *cr, XRectangle *rect)
+{
+    char sets_possible[3];
+    cairo_text_extents_t extents;
+
+    cairo_save (cr);
+    win_set_sets_possible_font (win, cr, sets_possible, &extents);
+    cairo_restore (cr);
+
+    rect->x = floor (win->width/2 - extents.width/2) - 1;
+    rect->y = floor (win->height/2 - extents.height/2) - 1;
+    rect->width = ceil (extents.width) + 3;
+    rect->height = ceil (extents.height) + 3;
+}
+
+static int
+rectangles_intersect (XRectangle *a, XRectangle *b)
+{
+    return (a->x < b->x + b->width && b->x < a->x + a->width &&
+	    a->y < b->y + b->height && b->y < a->y + a->height);
+}
+
+/* Work out what has changed since the last refresh: slots whose card
+ * or selection changed, the old and new sets-possible number, or the
+ * whole window after a resize. Then redraw only those rectangles,
+ * clipped, from the cached cards, and copy only them to the window.
+ * When nothing has changed nothing is drawn at all. */
 static void
 win_refresh(win_t *win)
 {
     cairo_t *cr;
     cairo_status_t status;
+    XRectangle damage[WIN_MAX_DAMAGE], slot, number, bounds;
+    int i, j, num_damage = 0;
+
+    if (win->slot_width != win->width / BOARD_COLS ||
+	win->slot_height != win->height / BOARD_ROWS)
+    {
+	win_flush_card_cache (win);
+	win->slot_width = win->width / BOARD_COLS;
+	win->slot_height = win->height / BOARD_ROWS;
+    }
 
     cr = cairo_create(win->surface);
 
+    if (win->drawn_width != win->width || win->drawn_height != win->height) {
+	damage[0].x = 0;
+	damage[0].y = 0;
+	damage[0].width = win->width;
+	damage[0].height = win->height;
+	num_damage = 1;
+    } else {
+	for (i=0; i < BOARD_MAX_SLOTS; i++)
+	    if (slot_changed (&win->board.slots[i], &win->drawn[i]))
+		win_slot_rectangle (win, i, &damage[num_damage++]);
+
+	/* A number that was hidden or changed leaves its old area to
+	 * be redrawn. */
+	if (win->drawn_sets_possible >= 0 &&
+	    (! win->display_sets_possible ||
+	     win->board.sets_possible != win->drawn_sets_possible))
+	    damage[num_damage++] = win->drawn_sets_possible_rect;
+    }
+
+    if (win->display_sets_possible) {
+	win_sets_possible_rectangle (win, cr, &number);
+	if (win->board.sets_possible != win->drawn_sets_possible)
+	    damage[num_damage++] = number;
+	win->drawn_sets_possible_rect = number;
+    }
+
+    win->drawn_width = win->width;
+    win->drawn_height = win->height;
+    win->drawn_sets_possible =
+	win->display_sets_possible ? win->board.sets_possible : -1;
+
+    if (num_damage == 0) {
+	cairo_destroy (cr);
+	return;
+    }
+
+    for (i=0; i < num_damage; i++)
+	cairo_rectangle (cr, damage[i].x, damage[i].y,
+			 damage[i].width, damage[i].height);
+    cairo_clip (cr);
+
+    /* The margins left over from whole-pixel slots */
     cairo_rectangle (cr, 0, 0, win->width, win->height);
+    cairo_rectangle (cr, 0, 0,
+		     BOARD_COLS * win->slot_width,
+		     BOARD_ROWS * win->slot_height);
+    cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
     cairo_set_source_rgb (cr, 1, 1, 1);
     cairo_fill (cr);
 
-    draw_board (cr, &win->board, win->width, win->height);
-
-    if (win->display_sets_possible) {
-	char sets_possible[3];
-	cairo_text_extents_t extents;
-
-	snprintf (sets_possible, 3, "%d", win->board.sets_possible);
-	sets_possible[2] = '\0';
-	
-	cairo_save (cr);
-	{
-	    cairo_select_font_face (cr, "sans", 0, 0);
-	    cairo_set_font_size (cr, win->height / 1.2);
-	    cairo_move_to (cr, 0, 0);
-	    cairo_text_extents (cr, sets_possible, &extents);
-	    cairo_move_to (cr,
-			   win->width/2 - (extents.x_bearing + extents.width/2),
-			   win->height/2 - (extents.y_bearing + extents.height/2));
-	    cairo_set_source_rgba (cr, 0, 0, .5, 0.75);
-	    cairo_show_text (cr, sets_possible);
-	}
-	cairo_restore (cr);
+    for (i=0; i < BOARD_MAX_SLOTS; i++) {
+	win_slot_rectangle (win, i, &slot);
+	for (j=0; j < num_damage; j++)
+	    if (rectangles_intersect (&slot, &damage[j])) {
+		win_draw_slot (win, cr, i);
+		break;
+	    }
     }
 
+    if (win->display_sets_possible)
+	win_draw_sets_possible (win, cr);
+
     status = cairo_status(cr);
     if (status) {
 	fprintf(stderr, "Cairo is unhappy: %s\n",
@@ -446,14 +680,50 @@ win_refresh(win_t *win)
     }
 
     cairo_destroy(cr);
+    cairo_surface_flush (win->surface);
+
+    /* One copy of the bounding box, clipped to the damage list */
+    bounds = damage[0];
+    for (i=1; i < num_damage; i++) {
+	int x2 = MAX (bounds.x + bounds.width, damage[i].x + damage[i].width);
+	int y2 = MAX (bounds.y + bounds.height, damage[i].y + damage[i].height);
+	bounds.x = MIN (bounds.x, damage[i].x);
+	bounds.y = MIN (bounds.y, damage[i].y);
+	bounds.width = x2 - bounds.x;
+	bounds.height = y2 - bounds.y;
+    }
 
+    XSetClipRectangles(win->dpy, win->gc, 0, 0, damage, num_damage, Unsorted);
     XCopyArea(win->dpy, win->pix, win->win, win->gc,
-	      0, 0, win->width, win->height,
-	      0, 0);
+	      bounds.x, bounds.y, bounds.width, bounds.height,
+	      bounds.x, bounds.y);
+    XSetClipMask(win->dpy, win->gc, None);
+}
+
+static void
+rng_init (rng_t *rng, uint64_t seed)
+{
+    /* One splitmix64 round, so nearby seeds give unrelated streams
+     * (and the state is never zero). */
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+    rng->state = (seed ^ (seed >> 31)) | 1;
+}
+
+/* Uniform in [0, 1) */
+static double
+rng_double (rng_t *rng)
+{
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+
+    return ((rng->state * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
 }
 
 static void
-deck_shuffle (deck_t *deck)
+deck_shuffle (deck_t *deck, rng_t *rng)
 {
     int i, r;
     card_t tmp;
@@ -461,7 +731,7 @@ deck_shuffle (deck_t *deck)
     assert (deck->num_cards <= DECK_MAX_CARDS);
 
     for (i=deck->num_cards - 1; i>=0; i--) {
-	r = (int) i * (rand() / (RAND_MAX + 1.0));
+	r = (int) ((i + 1) * rng_double (rng));
 	assert (r >= 0);
 	assert (r <= i);
 	tmp = deck->cards[i];
@@ -471,7 +741,7 @@ deck_shuffle (deck_t *deck)
 }
 
 static void
-deck_init (deck_t *deck)
+deck_init (deck_t *deck, rng_t *rng)
 {
     int card;
     int number;
@@ -488,44 +758,48 @@ deck_init (deck_t *deck)
 		    deck->cards[card].color = color;
 		    deck->cards[card].shading = shading;
 		    deck->cards[card].shape = shape;
+		    deck->cards[card].code = card_code (&deck->cards[card]);
 		    card++;
 		}
     deck->num_cards = card;
 
-    deck_shuffle (deck);
+    deck_shuffle (deck, rng);
 }
 
+/* Mark which cards are on the board, then look up the third card of
+ * every pair: O(n^2) rather than testing every triple. Each set is
+ * found once from each of its three pairs. */
 static void
 board_count_sets_possible (board_t *board)
 {
-    int i, j, k;
+    unsigned char present[DECK_MAX_CARDS] = { 0 };
+    int codes[BOARD_MAX_SIZE];
+    int i, j, n;
     int sets_possible = 0;
 
+    n = 0;
     for (i = 0; i < board->num_slots; i++) {
 	if (! board->slots[i].has_card)
 	    continue;
-	for (j = i+1; j < board->num_slots; j++) {
-	    if (! board->slots[j].has_card)
-		continue;
-	    for (k = j+1; k < board->num_slots; k++) {
-		if (! board->slots[k].has_card)
-		    continue;
-		if (is_set (&board->slots[i].card,
-			    &board->slots[j].card,
-			    &board->slots[k].card))
-		    sets_possible++;
-	    }
-	}
+	codes[n++] = board->slots[i].card.code;
+	present[board->slots[i].card.code] = 1;
     }
 
-    board->sets_possible = sets_possible;
+    for (i = 0; i < n; i++)
+	for (j = i+1; j < n; j++)
+	    sets_possible += present[card_code_third (codes[i], codes[j])];
+
+    board->sets_possible = sets_possible / 3;
 }
 
 static void
-board_init (board_t *board)
+board_init_size (board_t *board, int num_slots)
 {
     int i;
-    board->num_slots = BOARD_MAX_SLOTS;
+
+    assert (num_slots <= BOARD_MAX_SIZE);
+
+    board->num_slots = num_slots;
     for (i=0; i < board->num_slots; i++) {
 	board->slots[i].has_card = 0;
 	board->slots[i].selected = 0;
@@ -535,6 +809,12 @@ board_init (board_t *board)
     board_count_sets_possible (board);
 }
 
+static void
+board_init (board_t *board)
+{
+    board_init_size (board, BOARD_MAX_SLOTS);
+}
+
 static void
 deal (deck_t *deck, board_t *board)
 {
@@ -555,16 +835,16 @@ deal (deck_t *deck, board_t *board)
 
 /* Begin a new game */
 static void
-new_game (deck_t *deck, board_t *board)
+new_game (deck_t *deck, board_t *board, rng_t *rng)
 {
-    deck_init (deck);
+    deck_init (deck, rng);
     board_init (board);
     deal (deck, board);
 }
 
 /* Return the dealt cards to the deck, reshuffle, and deal again. */
 static int
-reshuffle (deck_t *deck, board_t *board)
+reshuffle (deck_t *deck, board_t *board, rng_t *rng)
 {
     int i;
 
@@ -580,12 +860,212 @@ reshuffle (deck_t *deck, board_t *board)
 	}
     }
 
-    deck_shuffle (deck);
+    deck_shuffle (deck, rng);
     deal (deck, board);
 
     return 1;
 }
 
+/* Find the first set on the board, by the same pair lookup as
+ * board_count_sets_possible. Returns 0 if there is none. */
+static int
+board_find_set (board_t *board, int set[3])
+{
+    int slot_of[DECK_MAX_CARDS];
+    int i, j, k;
+
+    for (i = 0; i < DECK_MAX_CARDS; i++)
+	slot_of[i] = -1;
+    for (i = 0; i < board->num_slots; i++)
+	if (board->slots[i].has_card)
+	    slot_of[board->slots[i].card.code] = i;
+
+    for (i = 0; i < board->num_slots; i++) {
+	if (! board->slots[i].has_card)
+	    continue;
+	for (j = i+1; j < board->num_slots; j++) {
+	    if (! board->slots[j].has_card)
+		continue;
+	    k = slot_of[card_code_third (board->slots[i].card.code,
+					 board->slots[j].card.code)];
+	    if (k >= 0) {
+		set[0] = i;
+		set[1] = j;
+		set[2] = k;
+		return 1;
+	    }
+	}
+    }
+
+    return 0;
+}
+
+/* Batch mode: headless games for gathering statistics */
+
+#define STATS_MAX_SETS 32
+/* Reshuffles in a row before the remaining cards are taken to hold
+ * no set at all. */
+#define BATCH_MAX_RESHUFFLES 100
+
+typedef struct stats {
+    long games;
+    long boards;
+    long reshuffles;
+    long board_sets[STATS_MAX_SETS + 1];	/* boards by sets possible */
+    long game_sets[DECK_MAX_CARDS / 3 + 1];	/* games by sets found */
+} stats_t;
+
+typedef struct batch_thread {
+    pthread_t thread;
+    int started;	/* else its shard runs on the main thread */
+    rng_t rng;
+    long games;
+    stats_t stats;
+} batch_thread_t;
+
+/* Play a game to the end, always taking the first set found and
+ * reshuffling when there is none. */
+static void
+batch_play_game (rng_t *rng, stats_t *stats)
+{
+    deck_t deck;
+    board_t board;
+    int set[3];
+    int i, sets_found = 0, stuck = 0;
+
+    new_game (&deck, &board, rng);
+
+    while (1) {
+	stats->boards++;
+	if (board.sets_possible > STATS_MAX_SETS)
+	    stats->board_sets[STATS_MAX_SETS]++;
+	else
+	    stats->board_sets[board.sets_possible]++;
+
+	if (board_find_set (&board, set)) {
+	    for (i=0; i < 3; i++)
+		board.slots[set[i]].has_card = 0;
+	    deal (&deck, &board);
+	    sets_found++;
+	    stuck = 0;
+	    continue;
+	}
+
+	if (deck.num_cards == 0 || ++stuck > BATCH_MAX_RESHUFFLES)
+	    break;
+
+	reshuffle (&deck, &board, rng);
+	stats->reshuffles++;
+    }
+
+    stats->game_sets[sets_found]++;
+    stats->games++;
+}
+
+static void *
+batch_thread_main (void *closure)
+{
+    batch_thread_t *thread = closure;
+    long i;
+
+    for (i = 0; i < thread->games; i++)
+	batch_play_game (&thread->rng, &thread->stats);
+
+    return NULL;
+}
+
+static void
+stats_add (stats_t *total, const stats_t *stats)
+{
+    unsigned int i;
+
+    total->games += stats->games;
+    total->boards += stats->boards;
+    total->reshuffles += stats->reshuffles;
+    for (i=0; i < ARRAY_SIZE (total->board_sets); i++)
+	total->board_sets[i] += stats->board_sets[i];
+    for (i=0; i < ARRAY_SIZE (total->game_sets); i++)
+	total->game_sets[i] += stats->game_sets[i];
+}
+
+static void
+stats_print (const stats_t *stats)
+{
+    unsigned int i;
+
+    printf ("Boards: %ld, %.2f per game, %.3f%% with no set\n",
+	    stats->boards, (double) stats->boards / stats->games,
+	    100.0 * stats->board_sets[0] / stats->boards);
+    printf ("Reshuffles: %.3f per game\n",
+	    (double) stats->reshuffles / stats->games);
+
+    printf ("\nSets possible per board:\n");
+    for (i=0; i < ARRAY_SIZE (stats->board_sets); i++)
+	if (stats->board_sets[i])
+	    printf ("%3d%s\t%12ld\t%8.4f%%\n", i,
+		    i == STATS_MAX_SETS ? "+" : "",
+		    stats->board_sets[i],
+		    100.0 * stats->board_sets[i] / stats->boards);
+
+    printf ("\nSets found per game:\n");
+    for (i=0; i < ARRAY_SIZE (stats->game_sets); i++)
+	if (stats->game_sets[i])
+	    printf ("%3d\t%12ld\t%8.4f%%\n", i,
+		    stats->game_sets[i],
+		    100.0 * stats->game_sets[i] / stats->games);
+}
+
+static int
+batch_run (long games, int threads, uint64_t seed)
+{
+    batch_thread_t *thread;
+    stats_t total;
+    struct timespec start, end;
+    double seconds;
+    int i;
+
+    thread = calloc (threads, sizeof (batch_thread_t));
+    if (thread == NULL)
+	return 1;
+    memset (&total, 0, sizeof (total));
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    for (i=0; i < threads; i++) {
+	rng_init (&thread[i].rng, seed + i);
+	thread[i].games = games / threads + (i < games % threads);
+	thread[i].started = pthread_create (&thread[i].thread, NULL,
+					    batch_thread_main, &thread[i]) == 0;
+	if (! thread[i].started)
+	    fprintf (stderr, "Failed to start thread %d, "
+		     "running its games on the main thread\n", i);
+    }
+
+    /* The shards are seeded independently of which thread runs them,
+     * so the results stay the same. */
+    for (i=0; i < threads; i++)
+	if (! thread[i].started)
+	    batch_thread_main (&thread[i]);
+
+    for (i=0; i < threads; i++) {
+	if (thread[i].started)
+	    pthread_join (thread[i].thread, NULL);
+	stats_add (&total, &thread[i].stats);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf ("%ld games on %d threads in %.3f sec: %.0f games/sec (seed %llu)\n\n",
+	    total.games, threads, seconds, total.games / seconds,
+	    (unsigned long long) seed);
+    stats_print (&total);
+
+    free (thread);
+
+    return 0;
+}
+
 static void
 win_init(win_t *win, Display *dpy)
 {
@@ -593,7 +1073,7 @@ win_init(win_t *win, Display *dpy)
     Window root;
     XGCValues gcv;
 
-    new_game (&win->deck, &win->board);
+    new_game (&win->deck, &win->board, &win->rng);
 
     win->dpy = dpy;
     win->width = 600;
@@ -626,6 +1106,16 @@ win_init(win_t *win, Display *dpy)
     win->click = 0;
     win->display_sets_possible = 0;
 
+    win->slot_width = 0;
+    win->slot_height = 0;
+    for (i=0; i < DECK_MAX_CARDS; i++) {
+	win->card_cache[i][0] = NULL;
+	win->card_cache[i][1] = NULL;
+    }
+    win->drawn_width = 0;
+    win->drawn_height = 0;
+    win->drawn_sets_possible = -1;
+
     win_refresh(win);
     win->needs_refresh = 0;
 
@@ -639,6 +1129,7 @@ win_deinit(win_t *win)
 {
     XFreeGC(win->dpy, win->gc);
     XFreePixmap(win->dpy, win->pix);
+    win_flush_card_cache (win);
     cairo_surface_destroy (win->surface);
     XDestroyWindow(win->dpy, win->win);
 }
@@ -802,7 +1293,7 @@ win_handle_events(win_t *win)
 static int
 new_game_cb (win_t *win)
 {
-    new_game (&win->deck, &win->board);
+    new_game (&win->deck, &win->board, &win->rng);
     win->needs_refresh = 1;
 
     return 0;
@@ -811,7 +1302,7 @@ new_game_cb (win_t *win)
 static int
 reshuffle_cb (win_t *win)
 {
-    if (reshuffle (&win->deck, &win->board))
+    if (reshuffle (&win->deck, &win->board, &win->rng))
 	win->display_sets_possible = 0;
     else
 	win->display_sets_possible = 1;